@@ -0,0 +1,33 @@
+// Minimal example of a workload kernel plugin for rtdag (see src/rtkernel.h).
+//
+// Build it with:
+//     cc -shared -fPIC -O2 -I../src kernel-plugin.c -o kernel-plugin.so
+//
+// Then load it with `rtdag -K ./kernel-plugin.so -C spin -c 100000` or by
+// listing it in the `kernel_plugins` attribute of the YAML input file and
+// using `spin` in `tasks_type`.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "rtkernel.h"
+
+static __thread int spin_size;
+
+static int spin_init(const struct rtkernel_params *params) {
+    spin_size = params->size;
+    return 0;
+}
+
+static uint64_t spin_step(uint64_t in) {
+    volatile uint64_t acc = in;
+    for (int i = 0; i < spin_size * spin_size; ++i) {
+        acc = acc * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    return in + (acc & 1) + 1;
+}
+
+const struct rtkernel rtdag_kernel_plugin[] = {
+    {"spin", spin_init, spin_step, NULL},
+    {NULL, NULL, NULL, NULL},
+};
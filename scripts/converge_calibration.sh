@@ -1,18 +1,34 @@
 #!/bin/bash
 
 function usage() {
-    echo "usage: ${BASH_SOURCE[0]} CPU FREQ DURATION_US"
+    echo "usage: ${BASH_SOURCE[0]} CPU FREQ DURATION_US [TOLERANCE] [MAX_ITER]"
+}
+
+function freq_max_all() {
+    local cpu
+    local ncpu
+
+    ncpu=$(nproc)
+    for ((cpu = 0; cpu < ncpu; cpu++)); do
+        cpufreq-set -c "$cpu" -g userspace
+
+        # Set the maximum freq on each CPU
+        cpufreq-set -c "$cpu" -f "$(cpufreq-info -c "$cpu" -l | cut -d ' ' -f 2)"
+    done
 }
 
 function main() {
-    local amidone
     local cpu
     local freq
     local duration_us
+    local tolerance
+    local max_iter
 
     cpu="$1"
     freq="$2"
     duration_us="$3"
+    tolerance="${4:-0.05}"
+    max_iter="${5:-20}"
 
     if [ -z "$cpu" ]; then
         echo "Missing CPU argument" >&2
@@ -32,26 +48,15 @@ function main() {
         false
     fi
 
-    local previous=0.0
-    local estimation_error=
-    TICKS_PER_US="${TICKS_PER_US:-}"
-
-    amidone=0
-    while [ $amidone = 0 ]; do
-        TICKS_PER_US=$(./calibrate.sh "$cpu" "$freq" "$duration_us" | tail -1 | cut -d\' -f2)
-        estimation_error=$(echo "($previous - $TICKS_PER_US) / $TICKS_PER_US" | bc -l)
-
-        # Convert to positive using string manipulation
-        estimation_error=${estimation_error#-}
+    # rtdag iterates in-process until two consecutive estimates differ by less
+    # than the tolerance, starting from TICKS_PER_US if already set
+    freq_max_all
+    cpufreq-set -c "$cpu" -f "$freq"
+    taskset -c "$cpu" chrt -f 99 ./build/rtdag -c "$duration_us" \
+        -e "$tolerance" -I "$max_iter" | tee /tmp/rt-dag.calib
+    freq_max_all
 
-        # Convert value printed by bc to true or false
-        if (($(echo "$estimation_error < 0.05" | bc -l))); then
-            amidone=1
-        fi
-
-        previous="$TICKS_PER_US"
-        export TICKS_PER_US
-    done
+    TICKS_PER_US=$(grep "export" /tmp/rt-dag.calib | cut -d '=' -f2 | cut -d "'" -f1)
 
     echo "Final answer:"
     echo "export TICKS_PER_US=$TICKS_PER_US"
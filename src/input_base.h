@@ -2,7 +2,74 @@
 #define RTDAG_INPUT_BASE_H
 
 #include <cstdio>
+#include <string>
 #include <type_traits>
+#include <vector>
+
+// A group of background load threads, one per CPU, that run alongside the
+// DAG without being part of it.
+struct interference_info {
+    // One thread is spawned on each of these CPUs
+    std::vector<int> cpus;
+
+    // compute, memory, cache, syscall (or any registered workload kernel)
+    std::string kernel;
+
+    // Fraction of each period spent running the kernel, in (0, 1]
+    float duty_cycle = 1;
+
+    // Duty-cycle period, in us
+    unsigned long period = 10000;
+
+    // other, batch, idle, fifo, rr
+    std::string policy = "other";
+
+    // Priority for fifo and rr, nice value for the others
+    int priority = 0;
+
+    // Size of the buffer used by memory and cache, in bytes; size of the
+    // problem for the other kernels (zero means the kernel default)
+    unsigned long size = 0;
+};
+
+// Online adaptation of the ticks_per_us of each task, based on the measured
+// duration of its jobs (disabled if gain is zero).
+struct ticks_adaptation {
+    // Fraction of the error corrected after each job, in [0, 1]
+    float gain = 0;
+
+    // Maximum relative deviation from the initial ticks_per_us
+    float bound = 0.2;
+};
+
+// Periodic sampling of the platform state while the DAG runs (disabled if the
+// period is zero).
+struct monitor_info {
+    // Sampling period, in us
+    unsigned long period = 0;
+
+    // The CPUs the calibration probe runs on at each sample, they should be
+    // idle (may be empty)
+    std::vector<int> probe_cpus;
+
+    // Duration of each probe, in us
+    unsigned long probe_us = 1000;
+};
+
+// How the timing statistics of the run are kept (see histogram.h)
+struct statistics_info {
+    // Keep every DAG response time, and write them to <dag_name>.log
+    bool raw_response_times = true;
+
+    // How often the percentiles are written while the DAG runs, in us (0 to
+    // write them only at the end)
+    unsigned long checkpoint = 0;
+
+    // Publish live counters in shared memory (see livestats.h), refreshing
+    // the percentiles every live_period us (0 only at the end)
+    bool live = false;
+    unsigned long live_period = 100000;
+};
 
 class input_base {
 public:
@@ -14,6 +81,7 @@ public:
     virtual unsigned get_n_tasks() const = 0;
     virtual unsigned get_n_edges() const = 0;
     virtual unsigned get_n_cpus() const = 0;
+    virtual const std::vector<int> &get_cpus_freq() const = 0;
     virtual unsigned get_max_out_edges() const = 0;
     virtual unsigned get_max_in_edges() const = 0;
     virtual unsigned get_msg_len() const = 0;
@@ -37,6 +105,38 @@ public:
     virtual unsigned int get_matrix_size(unsigned t) const = 0;
     virtual unsigned int get_omp_target(unsigned t) const = 0;
     virtual float get_ticks_per_us(unsigned t) const = 0;
+
+    // CPUs of the OpenMP thread team of the task (empty if not specified)
+    virtual const std::vector<int> &get_tasks_omp_cpus(unsigned t) const = 0;
+
+    // Execution-time trace replayed by the task ("" if none)
+    virtual const char *get_tasks_trace(unsigned t) const = 0;
+    virtual long long get_tasks_trace_offset(unsigned t) const = 0;
+    virtual float get_tasks_trace_scale(unsigned t) const = 0;
+    virtual bool get_tasks_trace_loop(unsigned t) const = 0;
+
+    // Whether the task records the performance counters of its jobs (see
+    // perfcounters.h)
+    virtual bool get_tasks_perf_counters(unsigned t) const = 0;
+
+    // Shared objects to load additional workload kernels from (see
+    // rtkernel.h)
+    virtual const std::vector<std::string> &get_kernel_plugins() const = 0;
+
+    // Background interference load to run alongside the DAG (may be empty)
+    virtual const std::vector<interference_info> &get_interference() const = 0;
+
+    // Online adaptation of ticks_per_us, shared by all the tasks
+    virtual const ticks_adaptation &get_ticks_adaptation() const = 0;
+
+    // Platform monitor running alongside the DAG
+    virtual const monitor_info &get_monitor() const = 0;
+
+    virtual const statistics_info &get_statistics() const = 0;
+
+    // Whether the originator waits for its releases on a timerfd instead of
+    // with clock_nanosleep (see periodic_task.h)
+    virtual bool get_release_timerfd() const = 0;
 };
 
 static inline void dump(const input_base &in) {
@@ -20,7 +20,8 @@ using namespace std;
 class input_header : public input_base {
 
 public:
-    input_header(const char *fname_) : input_base() {}
+    input_header(const char *fname_, bool discount_comm_ = true) :
+        input_base() {}
 
     const char *get_dagset_name() const override {
         return dagset_name;
@@ -38,6 +39,11 @@ public:
         return N_CPUS;
     }
 
+    const std::vector<int> &get_cpus_freq() const override {
+        static const std::vector<int> no_freqs;
+        return no_freqs;
+    }
+
     unsigned get_max_out_edges() const override {
         return MAX_OUT_EDGES_PER_TASK;
     }
@@ -97,6 +103,60 @@ public:
         return adjacency_matrix[t1][t2];
     }
 
+    const std::vector<int> &get_tasks_omp_cpus(unsigned) const override {
+        static const std::vector<int> no_cpus;
+        return no_cpus;
+    }
+
+    const char *get_tasks_trace(unsigned) const override {
+        return "";
+    }
+
+    long long get_tasks_trace_offset(unsigned) const override {
+        return 0;
+    }
+
+    float get_tasks_trace_scale(unsigned) const override {
+        return 1;
+    }
+
+    bool get_tasks_trace_loop(unsigned) const override {
+        return false;
+    }
+
+    bool get_tasks_perf_counters(unsigned) const override {
+        return false;
+    }
+
+    const std::vector<std::string> &get_kernel_plugins() const override {
+        static const std::vector<std::string> no_plugins;
+        return no_plugins;
+    }
+
+    const std::vector<interference_info> &get_interference() const override {
+        static const std::vector<interference_info> no_interference;
+        return no_interference;
+    }
+
+    const ticks_adaptation &get_ticks_adaptation() const override {
+        static const ticks_adaptation disabled;
+        return disabled;
+    }
+
+    const monitor_info &get_monitor() const override {
+        static const monitor_info disabled;
+        return disabled;
+    }
+
+    const statistics_info &get_statistics() const override {
+        static const statistics_info defaults;
+        return defaults;
+    }
+
+    bool get_release_timerfd() const override {
+        return false;
+    }
+
     static constexpr bool has_input_file = false;
 };
 
@@ -15,7 +15,13 @@ scenarios
 #include "input_base.h"
 #include "time_aux.h"
 #include "multi_queue.h"
+#include "newstuff/calibdb.h"
+#include "newstuff/commmodel.h"
 
+#include <sched.h>
+
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 #include <limits>
@@ -27,6 +33,7 @@ scenarios
 #define MAX_N_TASKS (std::numeric_limits<MultiQueue::mask_type>::digits)
 
 enum class yaml_error_type {
+    YAML_SILENT,
     YAML_WARN,
     YAML_ERROR,
 };
@@ -40,6 +47,8 @@ static inline constexpr const char *get_error_msg() {
         return "ERROR";
     } else if constexpr (error == yaml_error_type::YAML_WARN) {
         return "WARN";
+    } else if constexpr (error == yaml_error_type::YAML_SILENT) {
+        return "";
     } else {
         static_assert(always_false<error>, "Unexpected yaml_error_type!");
     }
@@ -51,7 +60,8 @@ template <yaml_error_type error>
 static inline void exit_if_fatal_error() {
     if constexpr (error == yaml_error_type::YAML_ERROR) {
         std::exit(EXIT_FAILURE);
-    } else if constexpr (error == yaml_error_type::YAML_WARN) {
+    } else if constexpr (error == yaml_error_type::YAML_WARN ||
+                         error == yaml_error_type::YAML_SILENT) {
         // Do nothing
     } else {
         static_assert(always_false<error>, "Unexpected yaml_error_type!");
@@ -62,8 +72,11 @@ template <class T, yaml_error_type error = yaml_error_type::YAML_WARN>
 static inline auto get_attribute(const YAML::Node &in, const char *attr,
                                  const char *fname, T default_v = {}) {
     if (!in[attr]) {
-        std::fprintf(stderr, "%s: missing attribute '%s' in input file %s.\n",
-                     get_error_msg<error>(), attr, fname);
+        if constexpr (error != yaml_error_type::YAML_SILENT) {
+            std::fprintf(stderr,
+                         "%s: missing attribute '%s' in input file %s.\n",
+                         get_error_msg<error>(), attr, fname);
+        }
         exit_if_fatal_error<error>();
         return default_v;
     }
@@ -103,7 +116,7 @@ private:
     // repetitions: int
     //
     // n_cpus: int
-    // cpus_freq: int[] # in MHz
+    // cpus_freq: int[] # in MHz, 0 to leave the cpu untouched
     //
     // dag_name: string
     // n_edges: int
@@ -125,6 +138,50 @@ private:
     //
     // # NOTE: there are other attributes not represented in this comment now!
     //
+    // kernel_plugins: string[] # optional, shared objects with more kernels
+    // calibration_db: string # optional, see calibdb.h
+    // comm_cost_model: string # optional, see commmodel.h
+    // release_timer: string # optional, nanosleep (default) or timerfd
+    // tasks_omp_cpus: int[][] # optional, CPUs of the omp_host thread teams
+    //
+    // # Optional background load, not part of the DAG (see interference.h):
+    // interference:
+    //   - cpus: int[]
+    //     kernel: string # compute, memory, cache, syscall
+    //     duty_cycle: float # optional, default 1
+    //     period: long # optional, in us, default 10000
+    //     policy: string # optional, other, batch, idle, fifo, rr
+    //     priority: int # optional, nice value for other, batch, idle
+    //     size: long # optional, buffer bytes (memory, cache), matrix size
+    //
+    // # Optional online adaptation of ticks_per_us (see rtask.h):
+    // ticks_adaptation:
+    //   gain: float # in [0, 1], 0 disables it
+    //   bound: float # optional, max relative deviation, default 0.2
+    //
+    // # Optional platform monitor, writes <dag_name>/monitor.csv (see
+    // # monitor.h):
+    // monitor:
+    //   period: long # in us, 0 disables it
+    //   probe_cpus: int[] # optional, default the CPUs without tasks
+    //   probe_us: long # optional, in us, default 1000
+    //
+    // # Optional, how the timing statistics are kept (see histogram.h):
+    // statistics:
+    //   raw_response_times: bool # optional, default true
+    //   checkpoint: long # optional, in us, 0 (default) only at the end
+    //   live: bool # optional, default false, see livestats.h
+    //   live_period: long # optional, in us, default 100000
+    //
+    // # Optional execution-time trace replay, per task (see exectrace.h):
+    // tasks_trace: string[] # "" if the task does not replay a trace
+    // tasks_trace_offset: int[] # index of the first job in the trace
+    // tasks_trace_scale: float[] # multiplies each value in the trace
+    // tasks_trace_loop: bool[] # wrap around at the end of the trace
+    //
+    // # Optional per-job performance counters (see perfcounters.h):
+    // tasks_perf_counters: bool[] # default false
+    //
     // adjacency_matrix: int[][]
     //
     // # (NOTE: sum of the longest path deadlines MUST be <= dag_deadline)
@@ -139,6 +196,22 @@ private:
     // the number of CPUs
     std::vector<int> cpu_freqs;
 
+    std::vector<string> kernel_plugins;
+
+    string calibration_db;
+
+    string comm_cost_model;
+
+    string release_timer = "nanosleep";
+
+    std::vector<interference_info> interference;
+
+    ticks_adaptation adaptation;
+
+    monitor_info monitor;
+
+    statistics_info statistics;
+
     // -------------------- DAG DATA ---------------------
 
     string dag_name;
@@ -162,8 +235,14 @@ private:
         int affinity;
         int matrix_size;
         int omp_target = 0;
+        std::vector<int> omp_cpus;
         float ticks_per_us = -1;
         float expected_wcet_ratio = 1;
+        string trace;
+        long long trace_offset = 0;
+        float trace_scale = 1;
+        bool trace_loop = false;
+        bool perf_counters = false;
 #if RTDAG_FRED_SUPPORT == ON
         int fred_id;
 #endif
@@ -179,7 +258,9 @@ private:
     square_matrix<int, MAX_N_TASKS> adjacency_matrix;
 
 public:
-    input_yaml(const char *fname) : input_base() {
+    // When discount_comm is false the comm_cost_model is not applied to the
+    // wcets (e.g., while the model itself is being measured, see -x)
+    input_yaml(const char *fname, bool discount_comm = true) : input_base() {
         YAML::Node input = read_yaml_file(fname);
 
 #define M_GET_ATTR(dest, attr)                                                 \
@@ -240,6 +321,15 @@ public:
         std::vector<int> task_prios_default(n_tasks, 0);
         std::vector<float> task_ewr_default(n_tasks, 1);
 
+        // Optional per-task attributes of optional features (no warning if
+        // missing, but they must be the right length if present):
+        std::vector<std::vector<int>> task_omp_cpus(n_tasks);
+        std::vector<string> task_trace(n_tasks);
+        std::vector<long long> task_trace_offset(n_tasks, 0);
+        std::vector<float> task_trace_scale(n_tasks, 1);
+        std::vector<bool> task_trace_loop(n_tasks, false);
+        std::vector<bool> task_perf_counters(n_tasks, false);
+
 #define M_GET_TASKS_VEC(dest, attr)                                            \
     (M_GET_ATTR(dest, attr),                                                   \
      exact_length<yaml_error_type::YAML_ERROR>(n_tasks, dest.size(), attr),    \
@@ -279,6 +369,157 @@ public:
 
         M_GET_TASKS_VEC_OPT(task_prios, "tasks_prio", task_prios_default);
 
+#define M_GET_ATTR_EXTRA(dest, attr)                                           \
+    dest = get_attribute<decltype(dest), yaml_error_type::YAML_SILENT>(        \
+        input, attr, fname, dest)
+
+#define M_GET_TASKS_VEC_EXTRA(dest, attr)                                      \
+    (M_GET_ATTR_EXTRA(dest, attr),                                             \
+     exact_length<yaml_error_type::YAML_ERROR>(n_tasks, dest.size(), attr),    \
+     (dest))
+
+        M_GET_ATTR_EXTRA(kernel_plugins, "kernel_plugins");
+        M_GET_ATTR_EXTRA(calibration_db, "calibration_db");
+        M_GET_ATTR_EXTRA(comm_cost_model, "comm_cost_model");
+        M_GET_ATTR_EXTRA(release_timer, "release_timer");
+
+        if (release_timer != "nanosleep" && release_timer != "timerfd") {
+            std::fprintf(stderr,
+                         "ERROR: release_timer must be nanosleep or "
+                         "timerfd, found %s\n",
+                         release_timer.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+
+        for (const auto &node : input["interference"]) {
+            interference_info info;
+
+#define M_GET_INTF_ATTR(dest, attr)                                            \
+    (dest = get_attribute<decltype(dest), yaml_error_type::YAML_ERROR>(        \
+         node, attr, fname))
+#define M_GET_INTF_ATTR_OPT(dest, attr)                                        \
+    (dest = get_attribute<decltype(dest), yaml_error_type::YAML_SILENT>(       \
+         node, attr, fname, dest))
+
+            M_GET_INTF_ATTR(info.cpus, "cpus");
+            M_GET_INTF_ATTR(info.kernel, "kernel");
+            M_GET_INTF_ATTR_OPT(info.duty_cycle, "duty_cycle");
+            M_GET_INTF_ATTR_OPT(info.period, "period");
+            M_GET_INTF_ATTR_OPT(info.policy, "policy");
+            M_GET_INTF_ATTR_OPT(info.priority, "priority");
+            M_GET_INTF_ATTR_OPT(info.size, "size");
+
+#undef M_GET_INTF_ATTR
+#undef M_GET_INTF_ATTR_OPT
+
+            if (info.duty_cycle <= 0 || info.duty_cycle > 1) {
+                std::fprintf(stderr,
+                             "ERROR: interference duty_cycle must be in "
+                             "(0, 1], found %f\n",
+                             info.duty_cycle);
+                std::exit(EXIT_FAILURE);
+            }
+
+            interference.push_back(info);
+        }
+
+        if (const auto &node = input["ticks_adaptation"]) {
+            adaptation.gain = get_attribute<float, yaml_error_type::YAML_ERROR>(
+                node, "gain", fname);
+            adaptation.bound =
+                get_attribute<float, yaml_error_type::YAML_SILENT>(
+                    node, "bound", fname, adaptation.bound);
+
+            if (adaptation.gain < 0 || adaptation.gain > 1 ||
+                adaptation.bound < 0 || adaptation.bound >= 1) {
+                std::fprintf(stderr,
+                             "ERROR: ticks_adaptation gain must be in [0, 1] "
+                             "and bound in [0, 1), found %f and %f\n",
+                             adaptation.gain, adaptation.bound);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+
+        if (const auto &node = input["monitor"]) {
+            monitor.period =
+                get_attribute<unsigned long, yaml_error_type::YAML_ERROR>(
+                    node, "period", fname);
+            monitor.probe_us =
+                get_attribute<unsigned long, yaml_error_type::YAML_SILENT>(
+                    node, "probe_us", fname, monitor.probe_us);
+
+            if (node["probe_cpus"]) {
+                monitor.probe_cpus =
+                    get_attribute<std::vector<int>,
+                                  yaml_error_type::YAML_ERROR>(
+                        node, "probe_cpus", fname);
+            } else {
+                // All the CPUs available to rtdag that no task and no
+                // interference is pinned to
+                cpu_set_t available;
+                CPU_ZERO(&available);
+                sched_getaffinity(0, sizeof(available), &available);
+                for (const auto &intf : interference) {
+                    for (int cpu : intf.cpus) {
+                        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+                            CPU_CLR(cpu, &available);
+                        }
+                    }
+                }
+                for (int cpu = 0; cpu < int(cpu_freqs.size()); ++cpu) {
+                    if (CPU_ISSET(cpu, &available) &&
+                        std::find(task_affinities.begin(),
+                                  task_affinities.end(),
+                                  cpu) == task_affinities.end()) {
+                        monitor.probe_cpus.push_back(cpu);
+                    }
+                }
+            }
+
+            if (monitor.period > 0 && monitor.probe_us >= monitor.period) {
+                std::fprintf(stderr,
+                             "ERROR: monitor probe_us must be shorter than "
+                             "its period, found %lu and %lu\n",
+                             monitor.probe_us, monitor.period);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+
+        if (const auto &node = input["statistics"]) {
+            statistics.raw_response_times =
+                get_attribute<bool, yaml_error_type::YAML_SILENT>(
+                    node, "raw_response_times", fname,
+                    statistics.raw_response_times);
+            statistics.checkpoint =
+                get_attribute<unsigned long, yaml_error_type::YAML_SILENT>(
+                    node, "checkpoint", fname, statistics.checkpoint);
+            statistics.live =
+                get_attribute<bool, yaml_error_type::YAML_SILENT>(
+                    node, "live", fname, statistics.live);
+            statistics.live_period =
+                get_attribute<unsigned long, yaml_error_type::YAML_SILENT>(
+                    node, "live_period", fname, statistics.live_period);
+        }
+
+        M_GET_TASKS_VEC_EXTRA(task_omp_cpus, "tasks_omp_cpus");
+        for (int i = 0; i < n_tasks; ++i) {
+            // The task thread is pinned only by tasks_affinity (if at all)
+            if (!task_omp_cpus[i].empty() && task_affinities[i] >= 0 &&
+                task_omp_cpus[i][0] != task_affinities[i]) {
+                fprintf(stderr,
+                        "WARNING: task %s: the first CPU of tasks_omp_cpus "
+                        "(%d) is the task thread, which runs on CPU %d "
+                        "(tasks_affinity)\n",
+                        task_names[i].c_str(), task_omp_cpus[i][0],
+                        task_affinities[i]);
+            }
+        }
+        M_GET_TASKS_VEC_EXTRA(task_trace, "tasks_trace");
+        M_GET_TASKS_VEC_EXTRA(task_trace_offset, "tasks_trace_offset");
+        M_GET_TASKS_VEC_EXTRA(task_trace_scale, "tasks_trace_scale");
+        M_GET_TASKS_VEC_EXTRA(task_trace_loop, "tasks_trace_loop");
+        M_GET_TASKS_VEC_EXTRA(task_perf_counters, "tasks_perf_counters");
+
         // Check in both directions
         exact_length<yaml_error_type::YAML_ERROR>(n_tasks, adj_mat.size(),
                                                   "adjacency_matrix");
@@ -305,8 +546,14 @@ public:
                 .affinity = task_affinities[i],
                 .matrix_size = task_matrix_size[i],
                 .omp_target = task_omp_target[i],
+                .omp_cpus = task_omp_cpus[i],
                 .ticks_per_us = task_ticks_us[i],
                 .expected_wcet_ratio = task_ewr[i],
+                .trace = task_trace[i],
+                .trace_offset = task_trace_offset[i],
+                .trace_scale = task_trace_scale[i],
+                .trace_loop = task_trace_loop[i],
+                .perf_counters = task_perf_counters[i],
 
 #if RTDAG_FRED_SUPPORT == ON
                 .fred_id = fred_ids[i],
@@ -320,8 +567,90 @@ public:
             }
         }
 
+        if (!calibration_db.empty()) {
+            resolve_ticks_per_us();
+        }
+
+        if (discount_comm && !comm_cost_model.empty()) {
+            discount_comm_cost();
+        }
+
 #undef M_GET_ATTR
 #undef M_GET_TASKS_VEC
+#undef M_GET_ATTR_EXTRA
+#undef M_GET_TASKS_VEC_EXTRA
+    }
+
+    // Takes the ticks_per_us of the tasks that do not specify one from the
+    // calibration database, tasks missing from it will use the global value
+    void resolve_ticks_per_us() {
+        CalibDB db;
+        db.load(calibration_db, true);
+
+        for (int i = 0; i < n_tasks; ++i) {
+            auto &task = tasks[i];
+            if (task.ticks_per_us > 0) {
+                continue;
+            }
+
+            const int cpu = task.affinity;
+            const int freq = (cpu >= 0 && unsigned(cpu) < cpu_freqs.size())
+                                 ? std::max(cpu_freqs[cpu], 0)
+                                 : 0;
+            auto value =
+                db.lookup({cpu, freq, task.type, task.matrix_size});
+            if (!value) {
+                std::fprintf(stderr,
+                             "WARN: no entry for task %s (cpu %d, %d MHz, "
+                             "%s, size %d) in calibration database %s.\n",
+                             task.name.c_str(), cpu, freq, task.type.c_str(),
+                             task.matrix_size, calibration_db.c_str());
+                continue;
+            }
+
+            task.ticks_per_us = value->ticks_per_us;
+        }
+    }
+
+    // Removes from the wcet of each task the time it spends communicating,
+    // taken from the communication cost model: pushing the messages on its
+    // output edges and reading the ones on its input edges. This way a job,
+    // communication included, lasts for the wcet given in the file.
+    void discount_comm_cost() {
+        CommModel model;
+        model.load(comm_cost_model, true);
+
+        std::vector<double> cost_ns(n_tasks, 0);
+        for (int from = 0; from < n_tasks; ++from) {
+            for (int to = 0; to < n_tasks; ++to) {
+                const int bytes = adjacency_matrix[from][to];
+                if (bytes < 1) {
+                    continue;
+                }
+
+                auto value = model.lookup(
+                    {tasks[from].affinity, tasks[to].affinity, bytes});
+                if (!value) {
+                    std::fprintf(stderr,
+                                 "WARN: no entry for edge %s -> %s (cpu %d -> "
+                                 "%d, %d bytes) in communication cost model "
+                                 "%s.\n",
+                                 tasks[from].name.c_str(),
+                                 tasks[to].name.c_str(), tasks[from].affinity,
+                                 tasks[to].affinity, bytes,
+                                 comm_cost_model.c_str());
+                    continue;
+                }
+
+                cost_ns[from] += value->push_ns;
+                cost_ns[to] += value->copy_ns;
+            }
+        }
+
+        for (int i = 0; i < n_tasks; ++i) {
+            const long long cost_us = std::llround(cost_ns[i] / 1000);
+            tasks[i].wcet = std::max(tasks[i].wcet - cost_us, 0LL);
+        }
     }
 
     const char *get_dagset_name() const override {
@@ -341,6 +670,10 @@ public:
         return cpu_freqs.size();
     }
 
+    const std::vector<int> &get_cpus_freq() const override {
+        return cpu_freqs;
+    }
+
     unsigned get_max_out_edges() const override {
         return max_out_edges;
     }
@@ -424,6 +757,54 @@ public:
         return v > 0 ? v : ticks_per_us;
     }
 
+    const std::vector<int> &get_tasks_omp_cpus(unsigned t) const override {
+        return tasks[t].omp_cpus;
+    }
+
+    const char *get_tasks_trace(unsigned t) const override {
+        return tasks[t].trace.c_str();
+    }
+
+    long long get_tasks_trace_offset(unsigned t) const override {
+        return tasks[t].trace_offset;
+    }
+
+    float get_tasks_trace_scale(unsigned t) const override {
+        return tasks[t].trace_scale;
+    }
+
+    bool get_tasks_trace_loop(unsigned t) const override {
+        return tasks[t].trace_loop;
+    }
+
+    bool get_tasks_perf_counters(unsigned t) const override {
+        return tasks[t].perf_counters;
+    }
+
+    const std::vector<string> &get_kernel_plugins() const override {
+        return kernel_plugins;
+    }
+
+    const std::vector<interference_info> &get_interference() const override {
+        return interference;
+    }
+
+    const ticks_adaptation &get_ticks_adaptation() const override {
+        return adaptation;
+    }
+
+    const monitor_info &get_monitor() const override {
+        return monitor;
+    }
+
+    const statistics_info &get_statistics() const override {
+        return statistics;
+    }
+
+    bool get_release_timerfd() const override {
+        return release_timer == "timerfd";
+    }
+
 public:
     static constexpr bool has_input_file = true;
 };
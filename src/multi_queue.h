@@ -11,6 +11,7 @@
 
 #include "logging.h"
 #include "newstuff/integers.h"
+#include "timesource.h"
 
 class MultiQueue {
 public:
@@ -27,6 +28,10 @@ private:
     // Message buffer
     std::vector<void *> elems;
 
+    // When each elem was pushed (see timesource.h), taken under the lock
+    // once the elem is free, so it does not include the wait for it
+    std::vector<u64> pushed_ns;
+
     // Indicates the number of tasks waiting for the i-th
     // elem to free up (zero-initialized in the constructor)
     std::vector<int> waiting;
@@ -40,7 +45,10 @@ private:
 
 public:
     MultiQueue(int num_elems) :
-        elems(num_elems), waiting(num_elems, 0), cv_busy(num_elems) {}
+        elems(num_elems),
+        pushed_ns(num_elems, 0),
+        waiting(num_elems, 0),
+        cv_busy(num_elems) {}
 
     // may block if the i-th elem is busy; returns 1 if all
     // elems have been pushed as input to target (so it has
@@ -57,6 +65,7 @@ public:
             waiting[i]--;
         }
         elems[i] = elem;
+        pushed_ns[i] = timesource_now_ns();
         busy_mask |= bit;
         if (busy_mask == ((u64(1) << elems.size()) - 1)) {
             // Original implementation used _signal, which
@@ -72,9 +81,10 @@ public:
     }
 
     // only unblock once all num_elems elems have been
-    // popped
-    inline void pop(void *dest[], int num_elems) {
-        assert(num_elems == elems.size());
+    // popped; if not NULL, pushed[i] is set to the push time
+    // of the i-th elem
+    inline void pop(void *dest[], int num_elems, u64 pushed[] = nullptr) {
+        assert(size_t(num_elems) == elems.size());
 
         std::unique_lock<std::mutex> lock(mtx);
         while (busy_mask != (u64(1) << num_elems) - 1) {
@@ -86,6 +96,10 @@ public:
         if (dest != nullptr) {
             std::memcpy(dest, elems.data(), sizeof(*dest) * elems.size());
         }
+        if (pushed != nullptr) {
+            std::memcpy(pushed, pushed_ns.data(),
+                        sizeof(*pushed) * pushed_ns.size());
+        }
 
         busy_mask = 0;
         for (int i = 0; i < num_elems; i++) {
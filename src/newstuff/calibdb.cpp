@@ -0,0 +1,76 @@
+#include "newstuff/calibdb.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+void CalibDB::load(const std::string &fname, bool must_exist) {
+    std::ifstream is(fname);
+    if (!is) {
+        if (!must_exist && errno == ENOENT) {
+            return;
+        }
+        std::fprintf(stderr, "ERROR: could not open calibration database %s!\n",
+                     fname.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::string line;
+    for (int lineno = 1; std::getline(is, line); ++lineno) {
+        std::istringstream ls(line);
+        key k;
+        entry e;
+        if (!(ls >> k.cpu)) {
+            // Empty line (or comment) are skipped
+            std::istringstream cs(line);
+            char c;
+            if (!(cs >> c) || c == '#') {
+                continue;
+            }
+        } else if (ls >> k.freq_mhz >> k.kernel >> k.size >> e.ticks_per_us &&
+                   e.ticks_per_us > 0) {
+            // The slowdown is optional
+            if (!(ls >> e.slowdown)) {
+                e.slowdown = 1;
+            }
+            entries[k] = e;
+            continue;
+        }
+
+        std::fprintf(stderr,
+                     "ERROR: invalid entry in calibration database %s:%d!\n",
+                     fname.c_str(), lineno);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+void CalibDB::save(const std::string &fname) const {
+    std::ofstream os(fname);
+    os << "# cpu freq_mhz kernel size ticks_per_us slowdown\n";
+    for (const auto &[k, e] : entries) {
+        os << k.cpu << ' ' << k.freq_mhz << ' ' << k.kernel << ' ' << k.size
+           << ' ' << e.ticks_per_us << ' ' << e.slowdown << '\n';
+    }
+
+    os.flush();
+    if (!os) {
+        std::fprintf(stderr, "ERROR: could not write calibration database %s: "
+                             "%s\n",
+                     fname.c_str(), std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+std::optional<CalibDB::entry> CalibDB::lookup(const key &k) const {
+    auto it = entries.find(k);
+    if (it == entries.end() && k.freq_mhz != 0) {
+        it = entries.find({k.cpu, 0, k.kernel, k.size});
+    }
+    if (it == entries.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
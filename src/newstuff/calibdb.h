@@ -0,0 +1,67 @@
+#ifndef RTDAG_CALIBDB_H
+#define RTDAG_CALIBDB_H
+
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+
+// Persistent table of ticks_per_us values, one per (cpu, frequency, kernel,
+// matrix size), produced by the calibration sweep (-s) and used to resolve the
+// ticks_per_us of the tasks that do not specify one (see input_yaml.h).
+//
+// The file is plain text, one entry per line:
+//
+//     # cpu freq_mhz kernel size ticks_per_us [slowdown]
+//     0 1200 cpu 16 11.14 1.23
+//
+// The optional slowdown is the ratio between the ticks_per_us measured on an
+// otherwise idle board and the one measured with all the calibrated CPUs busy
+// (parallel sweep, -p), 1 if unknown.
+//
+// Empty lines and lines starting with '#' are ignored. A frequency of 0 means
+// that the frequency was not set when calibrating, such entries match any
+// frequency when no exact entry exists.
+class CalibDB {
+public:
+    struct key {
+        int cpu;
+        int freq_mhz;
+        std::string kernel;
+        int size;
+
+        inline auto tie() const {
+            return std::tie(cpu, freq_mhz, kernel, size);
+        }
+
+        inline bool operator<(const key &other) const {
+            return tie() < other.tie();
+        }
+    };
+
+    struct entry {
+        float ticks_per_us;
+        float slowdown = 1;
+    };
+
+private:
+    std::map<key, entry> entries;
+
+public:
+    // Reads all the entries of the given file. If the file does not exist and
+    // must_exist is false the table is left empty. Exits on error.
+    void load(const std::string &fname, bool must_exist);
+
+    // Writes all the entries to the given file, sorted. Exits on error.
+    void save(const std::string &fname) const;
+
+    // Looks for the exact key first, then for the same key calibrated at an
+    // unspecified frequency
+    std::optional<entry> lookup(const key &k) const;
+
+    inline void set(const key &k, const entry &e) {
+        entries[k] = e;
+    }
+};
+
+#endif // RTDAG_CALIBDB_H
@@ -0,0 +1,215 @@
+#include "newstuff/chrometrace.h"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <set>
+
+// The two processes of the trace (see chrometrace.h)
+#define TRACE_PID_CPUS 1
+#define TRACE_PID_TASKS 2
+
+// The track of the tasks that are not pinned, in the CPUs process
+#define TRACE_TID_UNPINNED CPU_SETSIZE
+
+// ------------------------- HELPER FUNCTIONS -------------------------- //
+
+namespace {
+
+// Writes the comma-separated list of events, with times relative to base
+class trace_writer {
+    std::ostream &os;
+    const u64 base;
+    bool first = true;
+
+public:
+    trace_writer(std::ostream &os, u64 base) : os(os), base(base) {}
+
+    // Starts a new event, with the fields common to all of them
+    std::ostream &event(const char *ph, int pid, int tid) {
+        os << (first ? "\n" : ",\n") << R"({"ph":")" << ph
+           << R"(","pid":)" << pid << R"(,"tid":)" << tid;
+        first = false;
+        return os;
+    }
+
+    // Writes ,"ts":... (in us, as the format requires)
+    std::ostream &ts(u64 ns) {
+        return os << R"(,"ts":)" << (double(ns) - double(base)) / 1000;
+    }
+
+    // Writes value as a JSON string, quotes included
+    std::ostream &quoted(const std::string &value) {
+        os << '"';
+        for (const char c : value) {
+            switch (c) {
+            case '"':
+            case '\\':
+                os << '\\' << c;
+                break;
+            case '\n':
+                os << "\\n";
+                break;
+            case '\r':
+                os << "\\r";
+                break;
+            case '\t':
+                os << "\\t";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    static const char hex[] = "0123456789abcdef";
+                    os << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+                } else {
+                    os << c;
+                }
+            }
+        }
+        return os << '"';
+    }
+
+    std::ostream &name(const std::string &name) {
+        os << R"(,"name":)";
+        return quoted(name);
+    }
+
+    // A slice [begin, end) with the given name and category
+    void slice(int pid, int tid, const std::string &name, const char *cat,
+               u64 begin, u64 end, s64 iter) {
+        event("X", pid, tid);
+        this->name(name);
+        os << R"(,"cat":")" << cat << '"';
+        ts(begin);
+        os << R"(,"dur":)" << double(end - begin) / 1000 << R"(,"args":{"iter":)"
+           << iter << "}}";
+    }
+
+    void metadata(int pid, int tid, const char *what, const std::string &value) {
+        event("M", pid, tid);
+        name(what);
+        os << R"(,"args":{"name":)";
+        quoted(value) << "}}";
+    }
+};
+
+int cpu_track(const Task &task) {
+    return task.cpu >= 0 ? task.cpu : TRACE_TID_UNPINNED;
+}
+
+} // namespace
+
+// ------------------------- PUBLIC FUNCTIONS -------------------------- //
+
+bool write_chrome_trace(const Dag &dag,
+                        const std::vector<std::unique_ptr<Task>> &tasks,
+                        const std::string &fname) {
+    std::ofstream os(fname);
+    if (!os) {
+        return false;
+    }
+
+    // The records of each task, indexed by iter - jobs[t].front().iter
+    std::vector<std::vector<job_record>> jobs(tasks.size());
+    u64 base = std::numeric_limits<u64>::max();
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        tasks[t]->timeline.for_each([&](const job_record &job) {
+            jobs[t].push_back(job);
+            base = std::min(base, job.release);
+        });
+    }
+
+    const auto find_job = [&jobs](size_t t, s64 iter) -> const job_record * {
+        if (jobs[t].empty()) {
+            return nullptr;
+        }
+        const s64 idx = iter - jobs[t].front().iter;
+        return idx >= 0 && idx < s64(jobs[t].size()) ? &jobs[t][idx] : nullptr;
+    };
+
+    os << R"({"displayTimeUnit":"ns","traceEvents":[)";
+    trace_writer tw(os, base);
+
+    tw.metadata(TRACE_PID_CPUS, 0, "process_name", "CPUs");
+    tw.metadata(TRACE_PID_TASKS, 0, "process_name", "Tasks");
+
+    const u64 e2e_ns =
+        std::chrono::nanoseconds(dag.e2e_deadline).count();
+
+    std::set<int> cpus;
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        cpus.insert(cpu_track(*tasks[t]));
+        tw.metadata(TRACE_PID_TASKS, t, "thread_name", tasks[t]->name);
+    }
+    for (int cpu : cpus) {
+        tw.metadata(TRACE_PID_CPUS, cpu, "thread_name",
+                    cpu == TRACE_TID_UNPINNED ? "unpinned"
+                                              : "CPU " + std::to_string(cpu));
+    }
+
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        const Task &task = *tasks[t];
+        const u64 deadline_ns = task.scheduling.deadline().count();
+
+        for (const job_record &job : jobs[t]) {
+            if (job.input > job.release) {
+                tw.slice(TRACE_PID_TASKS, t, "wait", "wait", job.release,
+                         job.input, job.iter);
+            }
+            tw.slice(TRACE_PID_TASKS, t, task.name, "exec", job.start,
+                     job.end, job.iter);
+            if (job.publish > job.end) {
+                tw.slice(TRACE_PID_TASKS, t, "publish", "publish", job.end,
+                         job.publish, job.iter);
+            }
+            tw.slice(TRACE_PID_CPUS, cpu_track(task), task.name, "exec",
+                     job.start, job.end, job.iter);
+
+            if (deadline_ns > 0 && job.end - job.start > deadline_ns) {
+                tw.event("i", TRACE_PID_TASKS, t);
+                tw.name("deadline miss");
+                tw.ts(job.end);
+                os << R"(,"s":"t"})";
+            }
+
+            if (task.is_sink() && job.publish - job.release > e2e_ns) {
+                tw.event("i", TRACE_PID_TASKS, t);
+                tw.name("e2e deadline miss");
+                tw.ts(job.publish);
+                os << R"(,"s":"g","args":{"response_us":)"
+                   << double(job.publish - job.release) / 1000 << "}}";
+            }
+        }
+
+        // One flow per message, from the start of the slice of the producer
+        // (where it is bound) to the start of the slice of the consumer
+        for (const Edge *edge : task.in_buffers) {
+            const s64 edge_idx = edge - dag.edges.data();
+            const std::string name = tasks[edge->from]->name + " -> " +
+                                     tasks[edge->to]->name;
+
+            for (const job_record &job : jobs[t]) {
+                const job_record *producer = find_job(edge->from, job.iter);
+                if (producer == nullptr) {
+                    continue;
+                }
+
+                const s64 id = job.iter * s64(dag.edges.size()) + edge_idx;
+                tw.event("s", TRACE_PID_TASKS, edge->from);
+                tw.name(name);
+                tw.ts(producer->start);
+                os << R"(,"cat":"edge","id":)" << id << '}';
+
+                tw.event("f", TRACE_PID_TASKS, t);
+                tw.name(name);
+                tw.ts(job.start);
+                os << R"(,"cat":"edge","bp":"e","id":)" << id << '}';
+            }
+        }
+    }
+
+    os << "\n]}\n";
+    os.flush();
+    return bool(os);
+}
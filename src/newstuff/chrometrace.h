@@ -0,0 +1,27 @@
+#ifndef RTDAG_CHROMETRACE_H
+#define RTDAG_CHROMETRACE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "newstuff/rtask.h"
+
+// Writes the job timelines of all the tasks (see timeline.h) in the Chrome
+// JSON trace format, which both chrome://tracing and the Perfetto UI
+// (https://ui.perfetto.dev) open directly:
+//  - the "CPUs" process has one track per CPU, showing the computation of the
+//    jobs that ran on it;
+//  - the "Tasks" process has one track per task, showing for each job the
+//    waiting for inputs, the computation and the publishing of its outputs;
+//  - flow arrows go from each job to the jobs of the same activation that
+//    consume its messages;
+//  - instant markers flag the jobs whose computation exceeded the relative
+//    deadline of the task and the activations that missed the end-to-end
+//    deadline of the DAG.
+// Times are relative to the first release. Returns false on error.
+bool write_chrome_trace(const Dag &dag,
+                        const std::vector<std::unique_ptr<Task>> &tasks,
+                        const std::string &fname);
+
+#endif // RTDAG_CHROMETRACE_H
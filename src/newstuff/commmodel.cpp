@@ -0,0 +1,74 @@
+#include "newstuff/commmodel.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+void CommModel::load(const std::string &fname, bool must_exist) {
+    std::ifstream is(fname);
+    if (!is) {
+        if (!must_exist && errno == ENOENT) {
+            return;
+        }
+        std::fprintf(stderr,
+                     "ERROR: could not open communication cost model %s!\n",
+                     fname.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    std::string line;
+    for (int lineno = 1; std::getline(is, line); ++lineno) {
+        std::istringstream ls(line);
+        key k;
+        entry e;
+        if (!(ls >> k.from_cpu)) {
+            // Empty line (or comment) are skipped
+            std::istringstream cs(line);
+            char c;
+            if (!(cs >> c) || c == '#') {
+                continue;
+            }
+        } else if (ls >> k.to_cpu >> k.bytes >> e.push_ns >> e.handoff_ns >>
+                       e.handoff_p99_ns >> e.copy_ns &&
+                   k.bytes > 0) {
+            entries[k] = e;
+            continue;
+        }
+
+        std::fprintf(stderr,
+                     "ERROR: invalid entry in communication cost model %s:%d!\n",
+                     fname.c_str(), lineno);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+void CommModel::save(const std::string &fname) const {
+    std::ofstream os(fname);
+    os << "# from_cpu to_cpu bytes push_ns handoff_ns handoff_p99_ns copy_ns "
+          "ns_per_byte\n";
+    for (const auto &[k, e] : entries) {
+        os << k.from_cpu << ' ' << k.to_cpu << ' ' << k.bytes << ' '
+           << e.push_ns << ' ' << e.handoff_ns << ' ' << e.handoff_p99_ns << ' '
+           << e.copy_ns << ' ' << e.copy_ns / k.bytes << '\n';
+    }
+
+    os.flush();
+    if (!os) {
+        std::fprintf(stderr,
+                     "ERROR: could not write communication cost model %s: "
+                     "%s\n",
+                     fname.c_str(), std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+std::optional<CommModel::entry> CommModel::lookup(const key &k) const {
+    auto it = entries.find(k);
+    if (it == entries.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
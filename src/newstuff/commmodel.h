@@ -0,0 +1,70 @@
+#ifndef RTDAG_COMMMODEL_H
+#define RTDAG_COMMMODEL_H
+
+#include <map>
+#include <optional>
+#include <string>
+#include <tuple>
+
+// Persistent table of the communication costs of the edges, one per (sender
+// cpu, receiver cpu, message size), produced by the communication calibration
+// (-x) and used to discount them from the wcet of the tasks (see
+// input_yaml.h).
+//
+// The file is plain text, one entry per line, all times in ns:
+//
+//     # from_cpu to_cpu bytes push_ns handoff_ns handoff_p99_ns copy_ns
+//     #   ns_per_byte
+//     0 1 1024 310 5120 9800 95 0.0928
+//
+// - push_ns is spent by the sender to write the message and push it into the
+//   queue of the receiver;
+// - handoff_ns (median) and handoff_p99_ns go from the push to the receiver
+//   returning from its pop, including its wakeup;
+// - copy_ns is spent by the receiver to read the message, ns_per_byte is the
+//   same cost divided by the message size (ignored when loading).
+//
+// Empty lines and lines starting with '#' are ignored. A cpu of -1 means that
+// the task was not pinned.
+class CommModel {
+public:
+    struct key {
+        int from_cpu;
+        int to_cpu;
+        int bytes;
+
+        inline auto tie() const {
+            return std::tie(from_cpu, to_cpu, bytes);
+        }
+
+        inline bool operator<(const key &other) const {
+            return tie() < other.tie();
+        }
+    };
+
+    struct entry {
+        double push_ns;
+        double handoff_ns;
+        double handoff_p99_ns;
+        double copy_ns;
+    };
+
+private:
+    std::map<key, entry> entries;
+
+public:
+    // Reads all the entries of the given file. If the file does not exist and
+    // must_exist is false the table is left empty. Exits on error.
+    void load(const std::string &fname, bool must_exist);
+
+    // Writes all the entries to the given file, sorted. Exits on error.
+    void save(const std::string &fname) const;
+
+    std::optional<entry> lookup(const key &k) const;
+
+    inline void set(const key &k, const entry &e) {
+        entries[k] = e;
+    }
+};
+
+#endif // RTDAG_COMMMODEL_H
@@ -0,0 +1,270 @@
+#include "newstuff/cpufreq.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "logging.h"
+
+// ------------------------- HELPER FUNCTIONS -------------------------- //
+
+// The settings of a CPU before rtdag changed them
+struct cpufreq_saved {
+    int cpu;
+    std::string governor;
+    std::string min_freq;
+    std::string max_freq;
+
+    // Only meaningful if the governor was already userspace
+    std::string setspeed;
+
+    // The attributes to write back, in order, as full path and value (built
+    // in advance, so that the signal handler does not allocate)
+    std::vector<std::pair<std::string, std::string>> writes;
+};
+
+// Filled while applying, emptied when restoring (so that restoring twice is
+// harmless)
+static std::vector<cpufreq_saved> saved_cpus;
+
+// The signals that restore the settings before terminating, and the actions
+// they had before
+static const int restore_signals[] = {SIGINT, SIGTERM};
+static struct sigaction saved_actions[std::size(restore_signals)];
+static bool handlers_installed = false;
+
+std::string cpufreq_root() {
+    const char *root = std::getenv("RTDAG_CPUFREQ_ROOT");
+    return root && *root ? root : "/sys/devices/system/cpu";
+}
+
+static std::string attr_path(int cpu, const char *attr) {
+    return cpufreq_root() + "/cpu" + std::to_string(cpu) + "/cpufreq/" + attr;
+}
+
+static bool read_attr(int cpu, const char *attr, std::string &value) {
+    std::ifstream is(attr_path(cpu, attr));
+    return bool(std::getline(is, value));
+}
+
+static bool write_path(const std::string &path, const std::string &value) {
+    std::FILE *f = std::fopen(path.c_str(), "w");
+    if (f == nullptr) {
+        std::fprintf(stderr, "ERROR: could not open %s: %s\n", path.c_str(),
+                     std::strerror(errno));
+        return false;
+    }
+
+    // sysfs reports write errors on close
+    const bool ok = std::fputs(value.c_str(), f) >= 0;
+    if (std::fclose(f) != 0 || !ok) {
+        std::fprintf(stderr, "ERROR: could not write %s to %s: %s\n",
+                     value.c_str(), path.c_str(), std::strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static bool is_available(int cpu, long khz) {
+    std::string available;
+    if (!read_attr(cpu, "scaling_available_frequencies", available)) {
+        // Not all drivers export the list, let the write decide
+        return true;
+    }
+
+    std::istringstream is(available);
+    for (long freq; is >> freq;) {
+        if (freq == khz) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool write_attr(int cpu, const char *attr, const std::string &value) {
+    return write_path(attr_path(cpu, attr), value);
+}
+
+static void cpufreq_uninstall_handlers() {
+    if (!handlers_installed) {
+        return;
+    }
+
+    for (size_t i = 0; i < std::size(restore_signals); ++i) {
+        sigaction(restore_signals[i], &saved_actions[i], nullptr);
+    }
+    handlers_installed = false;
+}
+
+static void cpufreq_restore() {
+    // No signal must restore the same settings while they are cleared
+    cpufreq_uninstall_handlers();
+
+    for (auto it = saved_cpus.rbegin(); it != saved_cpus.rend(); ++it) {
+        const auto &saved = *it;
+        for (const auto &[path, value] : saved.writes) {
+            write_path(path, value);
+        }
+        LOG(INFO, "cpufreq: restored governor %s on cpu %d\n",
+            saved.governor.c_str(), saved.cpu);
+    }
+    saved_cpus.clear();
+}
+
+// Like cpufreq_restore(), using only async-signal-safe calls, then terminates
+// with the same signal
+static void cpufreq_signal_handler(int sig) {
+    for (auto it = saved_cpus.rbegin(); it != saved_cpus.rend(); ++it) {
+        for (const auto &[path, value] : it->writes) {
+            const int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+            if (fd >= 0) {
+                ssize_t ret = write(fd, value.data(), value.size());
+                (void)ret;
+                close(fd);
+            }
+        }
+    }
+
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void cpufreq_install_handlers() {
+    if (handlers_installed) {
+        return;
+    }
+
+    struct sigaction action = {};
+    action.sa_handler = cpufreq_signal_handler;
+    sigfillset(&action.sa_mask);
+    for (size_t i = 0; i < std::size(restore_signals); ++i) {
+        sigaction(restore_signals[i], nullptr, &saved_actions[i]);
+        // Keep ignoring what was ignored (e.g., SIGINT in the background)
+        if (saved_actions[i].sa_handler != SIG_IGN) {
+            sigaction(restore_signals[i], &action, nullptr);
+        }
+    }
+    handlers_installed = true;
+}
+
+[[noreturn]] static void cpufreq_fail() {
+    cpufreq_restore();
+    std::exit(EXIT_FAILURE);
+}
+
+static void cpufreq_apply(int cpu, long khz) {
+    cpufreq_saved saved{cpu, "", "", "", "", {}};
+    if (!read_attr(cpu, "scaling_governor", saved.governor) ||
+        !read_attr(cpu, "scaling_min_freq", saved.min_freq) ||
+        !read_attr(cpu, "scaling_max_freq", saved.max_freq)) {
+        std::fprintf(stderr, "ERROR: cpufreq is not available for cpu %d in "
+                             "%s!\n",
+                     cpu, cpufreq_root().c_str());
+        cpufreq_fail();
+    }
+    read_attr(cpu, "scaling_setspeed", saved.setspeed);
+
+    // Restore the limits first (from the largest), then the governor
+    saved.writes = {
+        {attr_path(cpu, "scaling_max_freq"), saved.max_freq},
+        {attr_path(cpu, "scaling_min_freq"), saved.min_freq},
+        {attr_path(cpu, "scaling_governor"), saved.governor},
+    };
+    if (saved.governor == "userspace" && !saved.setspeed.empty()) {
+        saved.writes.push_back(
+            {attr_path(cpu, "scaling_setspeed"), saved.setspeed});
+    }
+
+    if (!is_available(cpu, khz)) {
+        std::fprintf(stderr,
+                     "ERROR: frequency %ld kHz is not available for cpu %d!\n",
+                     khz, cpu);
+        cpufreq_fail();
+    }
+
+    // From now on, this CPU must be restored (block the signals meanwhile,
+    // their handler reads saved_cpus)
+    sigset_t blocked, previous;
+    sigemptyset(&blocked);
+    for (int sig : restore_signals) {
+        sigaddset(&blocked, sig);
+    }
+    pthread_sigmask(SIG_BLOCK, &blocked, &previous);
+    saved_cpus.push_back(saved);
+    pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+    // Widen the limits if needed, otherwise setspeed would be clamped
+    const std::string freq = std::to_string(khz);
+    if (!write_attr(cpu, "scaling_governor", "userspace") ||
+        (khz > std::atol(saved.max_freq.c_str()) &&
+         !write_attr(cpu, "scaling_max_freq", freq)) ||
+        (khz < std::atol(saved.min_freq.c_str()) &&
+         !write_attr(cpu, "scaling_min_freq", freq)) ||
+        !write_attr(cpu, "scaling_setspeed", freq)) {
+        cpufreq_fail();
+    }
+}
+
+static void cpufreq_verify(int cpu, long khz) {
+    std::string governor;
+    std::string setspeed;
+    if (!read_attr(cpu, "scaling_governor", governor) ||
+        governor != "userspace" ||
+        !read_attr(cpu, "scaling_setspeed", setspeed) ||
+        std::atol(setspeed.c_str()) != khz) {
+        // e.g., CPUs sharing the same policy with different frequencies
+        std::fprintf(stderr,
+                     "ERROR: could not set cpu %d to %ld kHz (governor %s, "
+                     "setspeed %s)!\n",
+                     cpu, khz, governor.c_str(), setspeed.c_str());
+        cpufreq_fail();
+    }
+
+    // The actual frequency may still differ (e.g., thermal throttling)
+    std::string cur;
+    if (read_attr(cpu, "scaling_cur_freq", cur) &&
+        std::abs(std::atol(cur.c_str()) - khz) > khz / 100) {
+        std::fprintf(stderr,
+                     "WARNING: cpu %d runs at %s kHz instead of %ld kHz!\n",
+                     cpu, cur.c_str(), khz);
+    }
+}
+
+// ------------------------- MEMBER FUNCTIONS -------------------------- //
+
+CpufreqGuard::CpufreqGuard(const std::vector<int> &freqs_mhz) {
+    static bool registered = false;
+    if (!registered) {
+        std::atexit(cpufreq_restore);
+        registered = true;
+    }
+    cpufreq_install_handlers();
+
+    for (int cpu = 0, ncpus = freqs_mhz.size(); cpu < ncpus; ++cpu) {
+        if (freqs_mhz[cpu] > 0) {
+            cpufreq_apply(cpu, freqs_mhz[cpu] * 1000L);
+        }
+    }
+
+    // Verify only when all the CPUs have been set, because CPUs in the same
+    // policy share the same frequency
+    for (int cpu = 0, ncpus = freqs_mhz.size(); cpu < ncpus; ++cpu) {
+        if (freqs_mhz[cpu] > 0) {
+            cpufreq_verify(cpu, freqs_mhz[cpu] * 1000L);
+            LOG(INFO, "cpufreq: cpu %d set to %d MHz\n", cpu, freqs_mhz[cpu]);
+        }
+    }
+}
+
+CpufreqGuard::~CpufreqGuard() {
+    cpufreq_restore();
+}
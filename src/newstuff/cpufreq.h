@@ -0,0 +1,31 @@
+#ifndef RTDAG_CPUFREQ_H
+#define RTDAG_CPUFREQ_H
+
+#include <string>
+#include <vector>
+
+// Applies the per-CPU frequencies of the DAG (cpus_freq, in MHz) through the
+// cpufreq userspace governor and restores the previous settings when
+// destroyed (or at exit, if the program terminates through std::exit, or on
+// SIGINT and SIGTERM, which are then raised again with their default action).
+//
+// CPU i is set to freqs_mhz[i]; CPUs with a zero (or negative) value are left
+// untouched. The sysfs tree is read from $RTDAG_CPUFREQ_ROOT if set (so that
+// the logic can be tested against a fake tree), otherwise from
+// /sys/devices/system/cpu.
+class CpufreqGuard {
+public:
+    // Applies and verifies all the frequencies. Exits on error, after
+    // restoring whatever was already changed.
+    CpufreqGuard(const std::vector<int> &freqs_mhz);
+
+    ~CpufreqGuard();
+
+    CpufreqGuard(const CpufreqGuard &) = delete;
+    CpufreqGuard &operator=(const CpufreqGuard &) = delete;
+};
+
+// The root of the sysfs cpufreq tree in use
+std::string cpufreq_root();
+
+#endif // RTDAG_CPUFREQ_H
@@ -0,0 +1,69 @@
+#include "newstuff/exectrace.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+void ExecTrace::load(s64 num_activations) {
+    std::ifstream is(fname);
+    if (!is) {
+        std::fprintf(stderr, "ERROR: could not open execution trace %s!\n",
+                     fname.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    demand_us.clear();
+
+    std::string line;
+    for (int lineno = 1; std::getline(is, line); ++lineno) {
+        std::istringstream ls(line);
+        double value;
+        if (!(ls >> value)) {
+            // Empty line (or comment) are skipped
+            std::istringstream cs(line);
+            char c;
+            if (!(cs >> c) || c == '#') {
+                continue;
+            }
+
+            std::fprintf(stderr,
+                         "ERROR: invalid value in execution trace %s:%d!\n",
+                         fname.c_str(), lineno);
+            std::exit(EXIT_FAILURE);
+        }
+
+        if (value < 0) {
+            std::fprintf(stderr,
+                         "ERROR: negative value in execution trace %s:%d!\n",
+                         fname.c_str(), lineno);
+            std::exit(EXIT_FAILURE);
+        }
+
+        demand_us.push_back(u64(value * scale + 0.5));
+    }
+
+    const s64 size = demand_us.size();
+    if (size < 1) {
+        std::fprintf(stderr, "ERROR: empty execution trace %s!\n",
+                     fname.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (offset < 0 || offset >= size) {
+        std::fprintf(stderr,
+                     "ERROR: offset %ld out of bounds for execution trace %s "
+                     "(%ld values)!\n",
+                     offset, fname.c_str(), size);
+        std::exit(EXIT_FAILURE);
+    }
+
+    if (!loop && offset + num_activations > size) {
+        std::fprintf(stderr,
+                     "ERROR: execution trace %s too short: %ld values from "
+                     "offset %ld, %ld jobs (set tasks_trace_loop to wrap "
+                     "around)!\n",
+                     fname.c_str(), size - offset, offset, num_activations);
+        std::exit(EXIT_FAILURE);
+    }
+}
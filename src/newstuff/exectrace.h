@@ -0,0 +1,47 @@
+#ifndef RTDAG_EXECTRACE_H
+#define RTDAG_EXECTRACE_H
+
+#include <string>
+#include <vector>
+
+#include "newstuff/integers.h"
+
+// Per-job execution demand replayed from a trace file.
+//
+// The trace file contains one value per line, the demand of a job in
+// microseconds; empty lines and lines starting with '#' are ignored. Job i of
+// the task will execute for (trace[offset + i] * scale) microseconds. If loop
+// is set, the trace wraps around when its end is reached, otherwise it must
+// contain enough values for all the jobs of the run.
+class ExecTrace {
+    std::string fname;
+    s64 offset;
+    float scale;
+    bool loop;
+
+    // Already scaled, filled by load()
+    std::vector<u64> demand_us;
+
+public:
+    ExecTrace(const std::string &fname, s64 offset, float scale, bool loop) :
+        fname(fname), offset(offset), scale(scale), loop(loop) {}
+
+    inline bool enabled() const {
+        return !fname.empty();
+    }
+
+    // Reads the whole trace in memory, checking that it can cover
+    // num_activations jobs. Exits on error.
+    void load(s64 num_activations);
+
+    // The demand of the iter-th job, in microseconds
+    inline u64 at(s64 iter) const {
+        s64 idx = offset + iter;
+        if (loop) {
+            idx %= s64(demand_us.size());
+        }
+        return demand_us[idx];
+    }
+};
+
+#endif // RTDAG_EXECTRACE_H
@@ -0,0 +1,53 @@
+#include "newstuff/histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+u64 LogHistogram::bucket_top(int idx) {
+    if (idx < (1 << HISTOGRAM_SUB_BITS)) {
+        return idx;
+    }
+    const int shift = idx / half - 1;
+    const u64 mantissa = idx - shift * half;
+    // Wraps around to the maximum u64 for the very last bucket
+    return ((mantissa + 1) << shift) - 1;
+}
+
+double LogHistogram::mean() const {
+    const u64 n = count();
+    return n > 0 ? double(sum.load(std::memory_order_relaxed)) / n : 0;
+}
+
+void LogHistogram::merge(const LogHistogram &other) {
+    const auto add = [](std::atomic<u64> &to, const std::atomic<u64> &from) {
+        to.store(to.load(std::memory_order_relaxed) +
+                     from.load(std::memory_order_relaxed),
+                 std::memory_order_relaxed);
+    };
+
+    const u64 n = other.count();
+    for (int idx = 0; idx < nbuckets; ++idx) {
+        add(counts[idx], other.counts[idx]);
+    }
+    add(sum, other.sum);
+    maximum.store(std::max(max(), other.max()), std::memory_order_relaxed);
+    total.store(total.load(std::memory_order_relaxed) + n,
+                std::memory_order_release);
+}
+
+u64 LogHistogram::percentile(double p) const {
+    const u64 n = count();
+    if (n == 0) {
+        return 0;
+    }
+
+    const u64 rank = std::max<u64>(std::ceil(p / 100 * n), 1);
+    u64 seen = 0;
+    for (int idx = 0; idx < nbuckets; ++idx) {
+        seen += counts[idx].load(std::memory_order_relaxed);
+        if (seen >= rank) {
+            return std::min(bucket_top(idx), max());
+        }
+    }
+    return max();
+}
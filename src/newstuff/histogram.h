@@ -0,0 +1,74 @@
+#ifndef RTDAG_HISTOGRAM_H
+#define RTDAG_HISTOGRAM_H
+
+#include <atomic>
+#include <bit>
+
+#include "newstuff/integers.h"
+
+// HDR-style log-linear histogram of u64 values (e.g., durations in ns), with
+// constant memory (about 30KiB) and a relative error below 1/64 over the
+// whole u64 range: values below 2^HISTOGRAM_SUB_BITS have their own bucket,
+// each following power of two is split in 2^(HISTOGRAM_SUB_BITS - 1) buckets.
+//
+// record() is O(1) and lock-free, but it must be called by a single thread;
+// other threads can read the histogram concurrently (e.g., for checkpoints),
+// seeing each counter either before or after each update.
+#define HISTOGRAM_SUB_BITS 7
+
+class LogHistogram {
+public:
+    static constexpr int half = 1 << (HISTOGRAM_SUB_BITS - 1);
+    static constexpr int nbuckets = (64 - HISTOGRAM_SUB_BITS + 2) * half;
+
+private:
+    std::atomic<u64> counts[nbuckets] = {};
+    std::atomic<u64> total = 0;
+    std::atomic<u64> sum = 0;
+    std::atomic<u64> maximum = 0;
+
+    static inline int bucket(u64 value) {
+        if (value < (u64(1) << HISTOGRAM_SUB_BITS)) {
+            return value;
+        }
+        const int shift = std::bit_width(value) - HISTOGRAM_SUB_BITS;
+        return shift * half + int(value >> shift);
+    }
+
+    // The highest value that falls in the given bucket
+    static u64 bucket_top(int idx);
+
+public:
+    inline void record(u64 value) {
+        auto &count = counts[bucket(value)];
+        count.store(count.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_relaxed);
+        sum.store(sum.load(std::memory_order_relaxed) + value,
+                  std::memory_order_relaxed);
+        if (value > maximum.load(std::memory_order_relaxed)) {
+            maximum.store(value, std::memory_order_relaxed);
+        }
+        total.store(total.load(std::memory_order_relaxed) + 1,
+                    std::memory_order_release);
+    }
+
+    u64 count() const {
+        return total.load(std::memory_order_acquire);
+    }
+
+    u64 max() const {
+        return maximum.load(std::memory_order_relaxed);
+    }
+
+    double mean() const;
+
+    // Adds all the values recorded by other (with the same single-writer
+    // rule as record())
+    void merge(const LogHistogram &other);
+
+    // The highest value equivalent to the one at the given percentile (in
+    // [0, 100]), capped at the maximum recorded value; 0 if empty
+    u64 percentile(double p) const;
+};
+
+#endif // RTDAG_HISTOGRAM_H
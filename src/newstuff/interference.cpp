@@ -0,0 +1,229 @@
+#include "newstuff/interference.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "logging.h"
+#include "periodic_task.h"
+#include "rtkernel.h"
+#include "time_aux.h"
+
+// ------------------------- HELPER FUNCTIONS -------------------------- //
+
+// One step of work of each kernel, must be short compared to the period
+using interference_step = u64 (*)(std::vector<u64> &buffer, u64 in);
+
+static u64 step_compute(std::vector<u64> &, u64 in) {
+    return Count_Ticks(1) + in;
+}
+
+// The bytes streamed by each step of the memory kernel, so that a step lasts
+// tens of us regardless of the size of the buffer
+#define INTERFERENCE_MEMORY_CHUNK (256 << 10)
+
+static u64 step_memory(std::vector<u64> &buffer, u64 in) {
+    // Stream through the buffer one chunk at a time, reading and writing each
+    // element; each interference thread resumes where its last step ended
+    static thread_local size_t offset = 0;
+    constexpr size_t chunk_elems = INTERFERENCE_MEMORY_CHUNK / sizeof(u64);
+
+    offset = offset < buffer.size() ? offset : 0;
+    const size_t end = std::min(offset + chunk_elems, buffer.size());
+    for (size_t i = offset; i < end; ++i) {
+        buffer[i] += in;
+    }
+    offset = end;
+    return buffer[in % buffer.size()];
+}
+
+static u64 step_cache(std::vector<u64> &buffer, u64 in) {
+    // Pseudo-random accesses with cache-line granularity, to thrash both the
+    // private and the shared caches
+    constexpr size_t line_elems = 64 / sizeof(u64);
+    const size_t nlines = buffer.size() / line_elems;
+
+    u64 idx = in;
+    for (size_t i = 0; i < 4096; ++i) {
+        idx = idx * 6364136223846793005ULL + 1442695040888963407ULL;
+        buffer[((idx >> 16) % nlines) * line_elems] += i;
+    }
+    return idx;
+}
+
+static u64 step_syscall(std::vector<u64> &, u64 in) {
+    for (int i = 0; i < 64; ++i) {
+        in += syscall(SYS_getppid);
+    }
+    return in;
+}
+
+static interference_step get_step(const interference_info &info) {
+    if (info.kernel == "compute" || rtkernel_find(info.kernel.c_str())) {
+        return step_compute;
+    }
+    if (info.kernel == "memory") {
+        return step_memory;
+    }
+    if (info.kernel == "cache") {
+        return step_cache;
+    }
+    if (info.kernel == "syscall") {
+        return step_syscall;
+    }
+    return nullptr;
+}
+
+static int get_policy(const std::string &policy) {
+    if (policy == "other") {
+        return SCHED_OTHER;
+    }
+    if (policy == "batch") {
+        return SCHED_BATCH;
+    }
+    if (policy == "idle") {
+        return SCHED_IDLE;
+    }
+    if (policy == "fifo") {
+        return SCHED_FIFO;
+    }
+    if (policy == "rr") {
+        return SCHED_RR;
+    }
+    return -1;
+}
+
+static void interference_setup(const interference_info &info, int cpu) {
+    char name[16];
+    std::snprintf(name, sizeof(name), "intf-%.7s-%d", info.kernel.c_str(),
+                  cpu);
+    pthread_setname_np(pthread_self(), name);
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) {
+        std::fprintf(stderr, "ERROR: could not pin interference to core %d!\n",
+                     cpu);
+        std::exit(EXIT_FAILURE);
+    }
+
+    const int policy = get_policy(info.policy);
+    const bool is_rt = policy == SCHED_FIFO || policy == SCHED_RR;
+
+    struct sched_param param = {};
+    param.sched_priority = is_rt ? info.priority : 0;
+    if (sched_setscheduler(0, policy, &param)) {
+        std::fprintf(stderr,
+                     "ERROR: could not set interference policy %s: %s\n",
+                     info.policy.c_str(), std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+
+    // With SCHED_OTHER/BATCH/IDLE, the priority is the nice value (of this
+    // thread only, on Linux)
+    if (!is_rt && info.priority != 0 &&
+        setpriority(PRIO_PROCESS, syscall(SYS_gettid), info.priority)) {
+        std::fprintf(stderr, "ERROR: could not set interference nice %d: %s\n",
+                     info.priority, std::strerror(errno));
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+static void interference_body(const interference_info &info, int cpu,
+                              const std::atomic<bool> &stop_requested) {
+    interference_setup(info, cpu);
+
+    const interference_step step = get_step(info);
+    std::vector<u64> buffer;
+    if (step == step_compute) {
+        const char *kernel_name =
+            info.kernel == "compute" ? "cpu" : info.kernel.c_str();
+        const int size = info.size > 0 ? info.size : 16;
+        rtkernel_params params{size, 0, nullptr, 0, 0};
+        if (rtkernel_init(rtkernel_find(kernel_name), &params)) {
+            std::exit(EXIT_FAILURE);
+        }
+    } else {
+        // Touch the whole buffer now, on the right CPU
+        const size_t size = info.size > 0 ? info.size : 32 << 20;
+        buffer.assign(std::max<size_t>(size / sizeof(u64), 64), 1);
+    }
+
+    const u64 busy_us = info.duty_cycle * info.period;
+    const bool sleeps = info.duty_cycle < 1;
+
+    period_info pinfo;
+    pinfo_init(&pinfo, US_TO_NSEC(info.period));
+
+    u64 acc = cpu;
+    while (!stop_requested.load(std::memory_order_relaxed)) {
+        const u64 begin = micros();
+        do {
+            acc = step(buffer, acc);
+        } while (micros() - begin < busy_us &&
+                 !stop_requested.load(std::memory_order_relaxed));
+
+        if (sleeps) {
+            pinfo_sum_period_and_wait(&pinfo);
+        }
+    }
+
+    if (step == step_compute) {
+        rtkernel_teardown();
+    }
+
+    LOG(DEBUG, "interference on core %d done (%lu)\n", cpu, acc);
+}
+
+// ------------------------- MEMBER FUNCTIONS -------------------------- //
+
+InterferenceSet::InterferenceSet(const std::vector<interference_info> &infos) :
+    infos(infos) {}
+
+InterferenceSet::~InterferenceSet() {
+    stop();
+}
+
+void InterferenceSet::start() {
+    // Check everything before spawning any thread (kernels may come from
+    // plugins, so it cannot be done any earlier)
+    for (const auto &info : infos) {
+        if (get_step(info) == nullptr) {
+            std::fprintf(stderr, "ERROR: unsupported interference kernel %s\n",
+                         info.kernel.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+
+        if (get_policy(info.policy) < 0) {
+            std::fprintf(stderr, "ERROR: unsupported interference policy %s\n",
+                         info.policy.c_str());
+            std::exit(EXIT_FAILURE);
+        }
+    }
+
+    stop_requested = false;
+    for (const auto &info : infos) {
+        for (int cpu : info.cpus) {
+            threads.emplace_back(interference_body, std::cref(info), cpu,
+                                 std::cref(stop_requested));
+        }
+    }
+}
+
+void InterferenceSet::stop() {
+    stop_requested = true;
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
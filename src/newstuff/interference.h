@@ -0,0 +1,41 @@
+#ifndef RTDAG_INTERFERENCE_H
+#define RTDAG_INTERFERENCE_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "input_base.h"
+#include "newstuff/integers.h"
+
+// Background load threads, not part of the DAG, used to measure the
+// response-time inflation of the DAG under controlled co-runner load.
+//
+// Each interference_info spawns one thread per listed CPU, pinned to it and
+// scheduled with the requested policy. Each thread repeats its kernel for
+// duty_cycle * period microseconds, then sleeps until the end of the period.
+// Available kernels:
+//  - compute: the rtgauss cpu kernel, on size x size matrices (16);
+//  - memory:  streaming reads and writes over a buffer of size bytes (32MiB),
+//             256KiB per step;
+//  - cache:   pseudo-random cache-line accesses over a buffer of size bytes;
+//  - syscall: a storm of cheap system calls;
+//  - any other registered workload kernel (see rtkernel.h).
+class InterferenceSet {
+    std::vector<interference_info> infos;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stop_requested = false;
+
+public:
+    InterferenceSet(const std::vector<interference_info> &infos);
+
+    ~InterferenceSet();
+
+    // Spawns all the interference threads (exits on invalid configuration)
+    void start();
+
+    // Stops all the interference threads and waits for them to terminate
+    void stop();
+};
+
+#endif // RTDAG_INTERFERENCE_H
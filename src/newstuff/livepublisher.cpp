@@ -0,0 +1,154 @@
+#include "newstuff/livepublisher.h"
+
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include "logging.h"
+#include "timesource.h"
+
+// ------------------------- MEMBER FUNCTIONS -------------------------- //
+
+LivePublisher::LivePublisher(const statistics_info &info, Dag &dag,
+                             const std::vector<std::unique_ptr<Task>> &tasks) :
+    info(info),
+    dag(dag),
+    tasks(tasks) {}
+
+LivePublisher::~LivePublisher() {
+    stop();
+}
+
+void LivePublisher::start() {
+    if (!info.live) {
+        return;
+    }
+
+    if (tasks.size() > LIVESTATS_MAX_TASKS) {
+        std::fprintf(stderr,
+                     "WARNING: live stats support up to %d tasks, found "
+                     "%zu, disabled\n",
+                     LIVESTATS_MAX_TASKS, tasks.size());
+        return;
+    }
+
+    // Readers of a previous run keep the old segment
+    const std::string shm_name = livestats_shm_name(dag.name);
+    shm_unlink(shm_name.c_str());
+    const int fd =
+        shm_open(shm_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd < 0 || ftruncate(fd, sizeof(livestats_segment))) {
+        std::fprintf(stderr,
+                     "WARNING: could not create the live stats segment %s: "
+                     "%s\n",
+                     shm_name.c_str(), std::strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+
+    void *addr = mmap(nullptr, sizeof(livestats_segment),
+                      PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::fprintf(stderr,
+                     "WARNING: could not map the live stats segment %s: %s\n",
+                     shm_name.c_str(), std::strerror(errno));
+        return;
+    }
+
+    segment = new (addr) livestats_segment();
+    segment->size = sizeof(livestats_segment);
+    segment->version = LIVESTATS_VERSION;
+    segment->pid = getpid();
+    segment->ntasks = tasks.size();
+    dag.name.copy(segment->dag_name, LIVESTATS_NAME_LEN - 1);
+    segment->period_ns = std::chrono::nanoseconds(dag.period).count();
+    segment->e2e_deadline_ns =
+        std::chrono::nanoseconds(dag.e2e_deadline).count();
+    segment->num_activations = dag.num_activations;
+
+    for (size_t t = 0; t < tasks.size(); ++t) {
+        livestats_task &live = segment->tasks[t];
+        tasks[t]->name.copy(live.name, LIVESTATS_NAME_LEN - 1);
+        live.cpu = tasks[t]->cpu;
+        tasks[t]->live = &live;
+    }
+    dag.live = &segment->dag;
+
+    segment->running.store(1, std::memory_order_relaxed);
+
+    // Readers check the magic first, everything above is visible then
+    segment->magic.store(LIVESTATS_MAGIC, std::memory_order_release);
+
+    if (info.live_period > 0) {
+        stop_requested = false;
+        thread = std::thread(&LivePublisher::body, this);
+    }
+}
+
+void LivePublisher::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_requested = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    if (segment == nullptr) {
+        return;
+    }
+
+    publish();
+    segment->running.store(0, std::memory_order_release);
+
+    for (const auto &task_ptr : tasks) {
+        task_ptr->live = nullptr;
+    }
+    dag.live = nullptr;
+
+    munmap(segment, sizeof(livestats_segment));
+    segment = nullptr;
+}
+
+void LivePublisher::body() {
+    pthread_setname_np(pthread_self(), "live");
+
+    struct sched_param param = {};
+    if (sched_setscheduler(0, SCHED_IDLE, &param)) {
+        LOG(WARNING, "could not set the live stats policy: %s\n",
+            std::strerror(errno));
+    }
+
+    const auto period = std::chrono::microseconds(info.live_period);
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!cv.wait_for(lock, period, [this] { return stop_requested; })) {
+        publish();
+    }
+}
+
+void LivePublisher::publish() {
+    const LogHistogram &hist = dag.response_hist;
+    livestats_percentiles_block &block = segment->response;
+
+    livestats_write_begin(block.seq);
+    livestats_set(block.time_ns, timesource_now_ns());
+    livestats_set(block.count, hist.count());
+    livestats_set(block.mean_ns, hist.mean());
+    for (int i = 0; i < LIVESTATS_NPERCENTILES; ++i) {
+        livestats_set(block.values_ns[i],
+                      hist.percentile(livestats_percentiles[i]));
+    }
+    livestats_set(block.max_ns, hist.max());
+    livestats_write_end(block.seq);
+}
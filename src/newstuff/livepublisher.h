@@ -0,0 +1,51 @@
+#ifndef RTDAG_LIVEPUBLISHER_H
+#define RTDAG_LIVEPUBLISHER_H
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "input_base.h"
+#include "newstuff/livestats.h"
+#include "newstuff/rtask.h"
+
+// Creates the live stats segment of the DAG (see livestats.h), hands the
+// blocks to the tasks and refreshes the percentiles of the DAG response times
+// every statistics_info::live_period us, from a SCHED_IDLE thread.
+class LivePublisher {
+    statistics_info info;
+    Dag &dag;
+    const std::vector<std::unique_ptr<Task>> &tasks;
+
+    livestats_segment *segment = nullptr;
+
+    std::thread thread;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stop_requested = false;
+
+public:
+    LivePublisher(const statistics_info &info, Dag &dag,
+                  const std::vector<std::unique_ptr<Task>> &tasks);
+
+    ~LivePublisher();
+
+    // Creates the segment and spawns the thread, if enabled. Must be called
+    // before the tasks start.
+    void start();
+
+    // Publishes the final percentiles, marks the DAG as terminated and
+    // unmaps the segment (which stays in place). Must be called after the
+    // tasks terminated.
+    void stop();
+
+private:
+    void body();
+
+    void publish();
+};
+
+#endif // RTDAG_LIVEPUBLISHER_H
@@ -0,0 +1,190 @@
+#ifndef RTDAG_LIVESTATS_H
+#define RTDAG_LIVESTATS_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include "newstuff/integers.h"
+
+// Live counters of a running DAG, published in the POSIX shared memory segment
+// "/rtdag.<dag_name>" (i.e., /dev/shm/rtdag.<dag_name>) and displayed by
+// rtdag-top. The segment is created when the DAG starts and left in place
+// when it terminates, with running set to 0, so the final values can still
+// be read.
+//
+// Each block of live values is protected by its own seqlock, with a single
+// writer: the counter is odd while the block is being updated, readers retry
+// until they read the same even value before and after the block (for a
+// bounded number of times, in case the writer died in the middle). Task
+// threads update only the block of their own task (and the sink the DAG
+// block), with a handful of relaxed atomic stores per job; the percentiles
+// are computed from the histograms by a SCHED_IDLE thread.
+
+#define LIVESTATS_MAGIC 0x31564c4741445452ULL // "RTDAGLV1"
+#define LIVESTATS_VERSION 1
+#define LIVESTATS_MAX_TASKS 64
+#define LIVESTATS_NAME_LEN 48
+
+// How many times a reader tries to read a block consistently
+#define LIVESTATS_READ_TRIES 100000
+
+// Percentiles of the DAG response times, in ns
+#define LIVESTATS_NPERCENTILES 6
+static constexpr double livestats_percentiles[LIVESTATS_NPERCENTILES] = {
+    50, 90, 99, 99.9, 99.99, 99.999};
+
+static_assert(std::atomic<u64>::is_always_lock_free,
+              "the live counters must be address-free");
+
+// Each block in its own cache line(s), so that the tasks do not share them
+struct alignas(64) livestats_task {
+    char name[LIVESTATS_NAME_LEN];
+    s32 cpu;
+
+    std::atomic<u32> seq;
+    std::atomic<u64> jobs;
+    std::atomic<u64> deadline_misses;
+
+    // Computation of the jobs (end - start), in ns
+    std::atomic<u64> last_exec_ns;
+    std::atomic<u64> max_exec_ns;
+
+    // Waiting for the inputs (input - release), in ns
+    std::atomic<u64> last_wait_ns;
+    std::atomic<u64> max_wait_ns;
+};
+
+struct alignas(64) livestats_dag {
+    std::atomic<u32> seq;
+    std::atomic<u64> activations;
+    std::atomic<u64> deadline_misses;
+    std::atomic<u64> last_response_ns;
+};
+
+struct alignas(64) livestats_percentiles_block {
+    std::atomic<u32> seq;
+
+    // When they were computed (see timesource.h)
+    std::atomic<u64> time_ns;
+    std::atomic<u64> count;
+    std::atomic<u64> mean_ns;
+    std::atomic<u64> values_ns[LIVESTATS_NPERCENTILES];
+    std::atomic<u64> max_ns;
+};
+
+struct livestats_segment {
+    // Stored last (release), once the fields below are written
+    std::atomic<u64> magic;
+
+    // Written once, before the tasks start
+    u32 version;
+    u32 size; // sizeof(livestats_segment)
+    s32 pid;
+    u32 ntasks;
+    char dag_name[LIVESTATS_NAME_LEN];
+    u64 period_ns;
+    u64 e2e_deadline_ns;
+    s64 num_activations;
+
+    // 0 once the DAG has terminated
+    std::atomic<u32> running;
+
+    livestats_dag dag;
+    livestats_percentiles_block response;
+    livestats_task tasks[LIVESTATS_MAX_TASKS];
+};
+
+// ------------------------- WRITER SIDE -------------------------- //
+
+inline void livestats_write_begin(std::atomic<u32> &seq) {
+    seq.store(seq.load(std::memory_order_relaxed) + 1,
+              std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+inline void livestats_write_end(std::atomic<u32> &seq) {
+    seq.store(seq.load(std::memory_order_relaxed) + 1,
+              std::memory_order_release);
+}
+
+inline void livestats_set(std::atomic<u64> &field, u64 value) {
+    field.store(value, std::memory_order_relaxed);
+}
+
+inline void livestats_set_max(std::atomic<u64> &field, u64 value) {
+    if (value > field.load(std::memory_order_relaxed)) {
+        field.store(value, std::memory_order_relaxed);
+    }
+}
+
+// Called by the task thread after each job (live may be NULL)
+inline void livestats_job(livestats_task *live, u64 exec_ns, u64 wait_ns,
+                          bool missed) {
+    if (live == nullptr) {
+        return;
+    }
+
+    livestats_write_begin(live->seq);
+    livestats_set(live->jobs, live->jobs.load(std::memory_order_relaxed) + 1);
+    if (missed) {
+        livestats_set(live->deadline_misses,
+                      live->deadline_misses.load(std::memory_order_relaxed) +
+                          1);
+    }
+    livestats_set(live->last_exec_ns, exec_ns);
+    livestats_set_max(live->max_exec_ns, exec_ns);
+    livestats_set(live->last_wait_ns, wait_ns);
+    livestats_set_max(live->max_wait_ns, wait_ns);
+    livestats_write_end(live->seq);
+}
+
+// Called by the sink after each activation (live may be NULL)
+inline void livestats_activation(livestats_dag *live, u64 response_ns,
+                                 bool missed) {
+    if (live == nullptr) {
+        return;
+    }
+
+    livestats_write_begin(live->seq);
+    livestats_set(live->activations,
+                  live->activations.load(std::memory_order_relaxed) + 1);
+    if (missed) {
+        livestats_set(live->deadline_misses,
+                      live->deadline_misses.load(std::memory_order_relaxed) +
+                          1);
+    }
+    livestats_set(live->last_response_ns, response_ns);
+    livestats_write_end(live->seq);
+}
+
+// ------------------------- READER SIDE -------------------------- //
+
+// Calls copy on the block until it reads it consistently. Returns false if it
+// could not within LIVESTATS_READ_TRIES tries (the copied values, if any, are
+// then unreliable).
+template <typename Block, typename F>
+bool livestats_read(const Block &block, F copy) {
+    for (int i = 0; i < LIVESTATS_READ_TRIES; ++i) {
+        const u32 before = block.seq.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        copy(block);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (block.seq.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The name of the shared memory segment of the given DAG
+inline std::string livestats_shm_name(const std::string &dag_name) {
+    return "/rtdag." + dag_name;
+}
+
+#endif // RTDAG_LIVESTATS_H
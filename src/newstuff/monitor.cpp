@@ -0,0 +1,203 @@
+#include "newstuff/monitor.h"
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "logging.h"
+#include "newstuff/cpufreq.h"
+#include "periodic_task.h"
+#include "rtdag_calib.h"
+#include "rtkernel.h"
+#include "time_aux.h"
+
+// The size of the matrices of the cpu kernel run by the probe
+#define MONITOR_PROBE_SIZE 16
+
+// ------------------------- HELPER FUNCTIONS -------------------------- //
+
+static std::string thermal_root() {
+    const char *root = std::getenv("RTDAG_THERMAL_ROOT");
+    return root && *root ? root : "/sys/class/thermal";
+}
+
+// A sysfs attribute, kept open and re-read at each sample
+struct monitor_source {
+    std::string column;
+    int fd;
+};
+
+static std::vector<monitor_source> open_sources() {
+    std::vector<monitor_source> sources;
+
+    const long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+    for (int cpu = 0; cpu < ncpus; ++cpu) {
+        const std::string path = cpufreq_root() + "/cpu" +
+                                 std::to_string(cpu) +
+                                 "/cpufreq/scaling_cur_freq";
+        const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            sources.push_back({"cpu" + std::to_string(cpu) + "_khz", fd});
+        }
+    }
+
+    for (int zone = 0;; ++zone) {
+        const std::string dir =
+            thermal_root() + "/thermal_zone" + std::to_string(zone);
+        const int fd = open((dir + "/temp").c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            break;
+        }
+
+        std::string type = "unknown";
+        std::ifstream(dir + "/type") >> type;
+        sources.push_back(
+            {"tz" + std::to_string(zone) + "_" + type + "_mc", fd});
+    }
+
+    return sources;
+}
+
+static long read_source(const monitor_source &source) {
+    char buffer[32];
+    const ssize_t len = pread(source.fd, buffer, sizeof(buffer) - 1, 0);
+    if (len <= 0) {
+        return -1;
+    }
+    buffer[len] = '\0';
+    return std::strtol(buffer, nullptr, 10);
+}
+
+static void monitor_pin(int cpu) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset)) {
+        std::fprintf(stderr, "ERROR: could not pin the monitor to core %d!\n",
+                     cpu);
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// ------------------------- MEMBER FUNCTIONS -------------------------- //
+
+Monitor::Monitor(const monitor_info &info, const std::string &fname,
+                 const std::atomic<s64> &activation) :
+    info(info),
+    fname(fname),
+    activation(activation) {}
+
+Monitor::~Monitor() {
+    stop();
+}
+
+void Monitor::start() {
+    if (info.period == 0) {
+        return;
+    }
+
+    stop_requested = false;
+    calibrated = {};
+    auto done = calibrated.get_future();
+    thread = std::thread(&Monitor::body, this);
+    done.wait();
+}
+
+void Monitor::stop() {
+    stop_requested = true;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+// Calibrates the probe on each CPU before lowering the priority, the following
+// probes are compared to these
+std::vector<float> Monitor::calibrate_probes() {
+    std::vector<float> probe_ticks;
+    if (info.probe_cpus.empty()) {
+        return probe_ticks;
+    }
+
+    rtkernel_params params{MONITOR_PROBE_SIZE, 0, nullptr, 0, 0};
+    if (rtkernel_init(rtkernel_find("cpu"), &params)) {
+        std::exit(EXIT_FAILURE);
+    }
+
+    const calibration_params calib = {
+        .tolerance = 0.02, .max_iter = 10, .samples = 3};
+    for (int cpu : info.probe_cpus) {
+        monitor_pin(cpu);
+        waste_calibrate();
+        probe_ticks.push_back(
+            calibrate_converge(info.probe_us, 10, calib, false).ticks_per_us);
+    }
+    return probe_ticks;
+}
+
+void Monitor::body() {
+    pthread_setname_np(pthread_self(), "monitor");
+
+    std::ofstream os(fname);
+    if (!os) {
+        std::fprintf(stderr, "ERROR: could not create monitor file %s!\n",
+                     fname.c_str());
+        std::exit(EXIT_FAILURE);
+    }
+
+    const std::vector<float> probe_ticks = calibrate_probes();
+    calibrated.set_value();
+
+    struct sched_param param = {};
+    if (sched_setscheduler(0, SCHED_IDLE, &param)) {
+        LOG(WARNING, "could not set the monitor policy: %s\n",
+            std::strerror(errno));
+    }
+
+    const auto sources = open_sources();
+
+    os << "time_us,activation";
+    for (const auto &source : sources) {
+        os << ',' << source.column;
+    }
+    for (int cpu : info.probe_cpus) {
+        os << ",probe_cpu" << cpu << ",probe_cpu" << cpu << "_cputime";
+    }
+    os << '\n';
+
+    period_info pinfo;
+    pinfo_init(&pinfo, US_TO_NSEC(info.period));
+
+    while (!stop_requested.load(std::memory_order_relaxed)) {
+        os << micros() << ',' << activation.load(std::memory_order_relaxed);
+        for (const auto &source : sources) {
+            os << ',' << read_source(source);
+        }
+        for (size_t i = 0; i < info.probe_cpus.size(); ++i) {
+            monitor_pin(info.probe_cpus[i]);
+            const u64 before = thread_micros();
+            const u64 wall = measure_ticks(info.probe_us, probe_ticks[i]);
+            const u64 cpu = thread_micros() - before;
+            os << ',' << double(wall) / info.probe_us << ','
+               << double(cpu) / info.probe_us;
+        }
+        os << '\n';
+
+        pinfo_sum_period_and_wait(&pinfo);
+    }
+
+    for (const auto &source : sources) {
+        close(source.fd);
+    }
+
+    if (!probe_ticks.empty()) {
+        rtkernel_teardown();
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef RTDAG_MONITOR_H
+#define RTDAG_MONITOR_H
+
+#include <atomic>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "input_base.h"
+#include "newstuff/integers.h"
+
+// Low-priority (SCHED_IDLE) thread that samples the platform state while the
+// DAG runs, so that response times can be related to thermal throttling and
+// frequency drift. Every period it records:
+//  - the current frequency of each CPU (scaling_cur_freq, in kHz, read from
+//    cpufreq_root(), see cpufreq.h);
+//  - the temperature of each thermal zone (in millidegrees Celsius, read from
+//    $RTDAG_THERMAL_ROOT if set, otherwise from /sys/class/thermal);
+//  - for each probe CPU, the duration of a short run of the cpu kernel
+//    relative to the same run when the monitor started (1 means no drift,
+//    larger values mean that the CPU got slower), both in wall-clock time and
+//    in CPU time of the monitor thread. Being SCHED_IDLE, the probe is
+//    preempted by anything else running on the CPU: only the latter excludes
+//    that time, and shows the actual slowdown of the CPU.
+//
+// The baseline of the probes is calibrated by start(), which returns only
+// once it is done, so the monitor must be started before any background
+// load (see interference.h).
+//
+// Each sample is a line of the given CSV file, with the time (in us, on the
+// same clock as the task timestamps) and the index of the current activation
+// of the DAG (-1 before the first one). Values that cannot be read are -1.
+class Monitor {
+    monitor_info info;
+    std::string fname;
+    const std::atomic<s64> &activation;
+
+    std::thread thread;
+    std::atomic<bool> stop_requested = false;
+    std::promise<void> calibrated;
+
+public:
+    Monitor(const monitor_info &info, const std::string &fname,
+            const std::atomic<s64> &activation);
+
+    ~Monitor();
+
+    // Spawns the monitor thread, if enabled, and waits for it to calibrate
+    // the probes
+    void start();
+
+    // Stops the monitor thread and waits for it to terminate
+    void stop();
+
+private:
+    void body();
+    std::vector<float> calibrate_probes();
+};
+
+#endif // RTDAG_MONITOR_H
@@ -0,0 +1,226 @@
+#include "newstuff/perfcounters.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "newstuff/timeline.h"
+
+// The group of the software and hardware counters
+#define PERF_GROUP_SW 0
+#define PERF_GROUP_HW 1
+
+struct perf_counter_desc {
+    const char *column;
+    u32 type;
+    u64 config;
+};
+
+static constexpr perf_counter_desc perf_descs[PERF_NCOUNTERS] = {
+    {"task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+    {"context_switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+    {"cpu_migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS},
+    {"page_faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS},
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"llc_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+};
+
+// ------------------------- HELPER FUNCTIONS -------------------------- //
+
+static int perf_open(const perf_counter_desc &desc, int group_fd) {
+    perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = desc.type;
+    attr.config = desc.config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_hv = 1;
+
+    // This thread only, on any CPU
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+    if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+        // perf_event_paranoid >= 2 allows only user-space counting
+        attr.exclude_kernel = 1;
+        fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+    }
+    return fd;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Reads a hardware counter from user space, following the protocol described
+// in linux/perf_event.h. Returns false if the counter is not currently
+// scheduled on the PMU (or rdpmc is not allowed).
+static inline bool perf_rdpmc(const volatile perf_event_mmap_page *page,
+                              u64 &value) {
+    u32 seq;
+    u64 count;
+    do {
+        seq = page->lock;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+
+        const u32 idx = page->index;
+        if (!page->cap_user_rdpmc || idx == 0) {
+            return false;
+        }
+
+        u32 lo, hi;
+        asm volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(idx - 1));
+
+        // Sign-extend the pmc_width bits of the counter
+        const int shift = 64 - page->pmc_width;
+        s64 pmc = s64((u64(hi) << 32) | lo);
+        pmc = s64(u64(pmc) << shift) >> shift;
+        count = page->offset + pmc;
+
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    } while (page->lock != seq);
+
+    value = count;
+    return true;
+}
+#endif
+
+// ------------------------- MEMBER FUNCTIONS -------------------------- //
+
+PerfCounters::~PerfCounters() {
+    for (counter &c : counters) {
+        if (c.page != nullptr) {
+            munmap(c.page, sysconf(_SC_PAGESIZE));
+        }
+        if (c.fd >= 0) {
+            close(c.fd);
+        }
+    }
+}
+
+bool PerfCounters::open(const std::string &who, s64 jobs) {
+    for (int i = 0; i < PERF_NCOUNTERS; ++i) {
+        const perf_counter_desc &desc = perf_descs[i];
+        const int group =
+            desc.type == PERF_TYPE_SOFTWARE ? PERF_GROUP_SW : PERF_GROUP_HW;
+
+        // The first counter that can be opened leads the group
+        const int leader = leaders[group];
+        const int fd =
+            perf_open(desc, leader >= 0 ? counters[leader].fd : -1);
+        if (fd < 0) {
+            std::fprintf(stderr,
+                         "WARNING: task %s: perf counter %s not available: "
+                         "%s\n",
+                         who.c_str(), desc.column, std::strerror(errno));
+            continue;
+        }
+
+        counters[i] = {fd, group, sizes[group]++};
+        if (leader < 0) {
+            leaders[group] = i;
+        }
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    // rdpmc only if all the hardware counters allow it
+    use_rdpmc = leaders[PERF_GROUP_HW] >= 0;
+    for (counter &c : counters) {
+        if (c.fd < 0 || c.group != PERF_GROUP_HW) {
+            continue;
+        }
+
+        void *page = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ,
+                          MAP_SHARED, c.fd, 0);
+        if (page == MAP_FAILED) {
+            use_rdpmc = false;
+            continue;
+        }
+        c.page = static_cast<perf_event_mmap_page *>(page);
+        use_rdpmc &= c.page->cap_user_rdpmc;
+    }
+#endif
+
+    if (!enabled()) {
+        return false;
+    }
+
+    // Like the job timeline, touched now
+    const u64 size = std::bit_ceil(
+        u64(std::clamp<s64>(jobs, 1, TIMELINE_MAX_JOBS)));
+    ring.assign(size, perf_record{});
+    mask = size - 1;
+    head = 0;
+    read_all(before);
+    return true;
+}
+
+void PerfCounters::read_all(std::array<u64, PERF_NCOUNTERS> &values) const {
+    bool read_group[2] = {leaders[PERF_GROUP_SW] >= 0,
+                          leaders[PERF_GROUP_HW] >= 0};
+
+#if defined(__x86_64__) || defined(__i386__)
+    if (use_rdpmc) {
+        // If any is not scheduled on the PMU right now, fall back to read()
+        bool all = true;
+        for (int i = 0; i < PERF_NCOUNTERS && all; ++i) {
+            all = counters[i].page == nullptr ||
+                  perf_rdpmc(counters[i].page, values[i]);
+        }
+        read_group[PERF_GROUP_HW] = !all;
+    }
+#endif
+
+    for (int group : {PERF_GROUP_SW, PERF_GROUP_HW}) {
+        if (!read_group[group]) {
+            continue;
+        }
+
+        // PERF_FORMAT_GROUP: the number of counters, then their values
+        u64 buffer[1 + PERF_NCOUNTERS];
+        const ssize_t len = ::read(counters[leaders[group]].fd, buffer,
+                                   sizeof(u64) * (1 + sizes[group]));
+        if (len < ssize_t(sizeof(u64) * (1 + sizes[group]))) {
+            continue;
+        }
+
+        for (int i = 0; i < PERF_NCOUNTERS; ++i) {
+            if (counters[i].fd >= 0 && counters[i].group == group) {
+                values[i] = buffer[1 + counters[i].pos];
+            }
+        }
+    }
+}
+
+bool PerfCounters::write_csv(const std::string &fname) const {
+    std::ofstream os(fname);
+    if (!os) {
+        return false;
+    }
+
+    os << "iter";
+    for (int i = 0; i < PERF_NCOUNTERS; ++i) {
+        if (counters[i].fd >= 0) {
+            os << ',' << perf_descs[i].column;
+        }
+    }
+    os << '\n';
+
+    const u64 first = head > ring.size() ? head - ring.size() : 0;
+    for (u64 j = first; j < head; ++j) {
+        const perf_record &record = ring[j & mask];
+        os << record.iter;
+        for (int i = 0; i < PERF_NCOUNTERS; ++i) {
+            if (counters[i].fd >= 0) {
+                os << ',' << record.values[i];
+            }
+        }
+        os << '\n';
+    }
+
+    os.flush();
+    return bool(os);
+}
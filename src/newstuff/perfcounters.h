@@ -0,0 +1,101 @@
+#ifndef RTDAG_PERFCOUNTERS_H
+#define RTDAG_PERFCOUNTERS_H
+
+#include <linux/perf_event.h>
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "newstuff/integers.h"
+
+// The counters recorded for each job, software ones first
+enum perf_counter_id {
+    PERF_TASK_CLOCK,       // ns spent on the CPU
+    PERF_CONTEXT_SWITCHES, // including preemptions
+    PERF_CPU_MIGRATIONS,
+    PERF_PAGE_FAULTS,
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_LLC_MISSES,
+    PERF_NCOUNTERS,
+};
+
+// The deltas of the counters during a job
+struct perf_record {
+    s64 iter;
+    std::array<u64, PERF_NCOUNTERS> values;
+};
+
+// Per-thread performance counters (see perf_event_open(2)), read around the
+// computation of each job and stored in a fixed-size ring, like the job
+// timeline (see timeline.h).
+//
+// The software counters are always available (unless perf_event_paranoid
+// forbids them), the hardware ones only if the kernel exposes a PMU (often not
+// inside VMs): each counter that cannot be opened is skipped with a warning
+// and left out of the output. Counters are opened in two groups (software and
+// hardware), each read with a single read(); on x86 the hardware counters are
+// read in user space with rdpmc when the kernel allows it.
+class PerfCounters {
+    struct counter {
+        int fd = -1;
+
+        // Index of the group (0 software, 1 hardware) and position in it
+        int group;
+        int pos;
+
+        // Mapped only for the hardware counters, to read them with rdpmc
+        perf_event_mmap_page *page = nullptr;
+    };
+
+    std::array<counter, PERF_NCOUNTERS> counters;
+    std::array<int, 2> leaders = {-1, -1};
+    std::array<int, 2> sizes = {0, 0};
+    bool use_rdpmc = false;
+
+    std::array<u64, PERF_NCOUNTERS> before = {};
+
+    std::vector<perf_record> ring;
+    u64 mask = 0;
+    u64 head = 0;
+
+    // Reads the current value of all the open counters
+    void read_all(std::array<u64, PERF_NCOUNTERS> &values) const;
+
+public:
+    PerfCounters() = default;
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+    ~PerfCounters();
+
+    // Opens the counters for the calling thread and allocates room for the
+    // given number of jobs (see JobTimeline::init()). The name of the task is
+    // used only in the warnings. Returns false if no counter is available.
+    bool open(const std::string &who, s64 jobs);
+
+    inline bool enabled() const {
+        return leaders[0] >= 0 || leaders[1] >= 0;
+    }
+
+    // Called right before and right after the computation of each job
+    inline void start() {
+        read_all(before);
+    }
+
+    inline void stop(s64 iter) {
+        perf_record &record = ring[head++ & mask];
+        read_all(record.values);
+        record.iter = iter;
+        for (int i = 0; i < PERF_NCOUNTERS; ++i) {
+            record.values[i] -= before[i];
+        }
+    }
+
+    // Writes the records still in the ring to a CSV file, one column per
+    // available counter. Must be called only after the thread terminated.
+    // Returns false on error.
+    bool write_csv(const std::string &fname) const;
+};
+
+#endif // RTDAG_PERFCOUNTERS_H
@@ -1,11 +1,19 @@
 #include "newstuff/rtask.h"
 #include "logging.h"
+#include "newstuff/usdt.h"
 #include "periodic_task.h"
+#include "timesource.h"
 #include <string_view>
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <istream>
+#include <limits>
 #include <ostream>
 #include <span>
 
@@ -52,42 +60,37 @@ static inline void task_pin(int cpu) {
     }
 }
 
-// static inline void task_open_exec_time_file(task_data &task,
-//                                             ofstream &exec_time_f) {
-//     std::stringstream ss;
-//     // TODO: this is not the correct way in C++ to build a valid path!
-//     ss << task.dag.name << "/";
-//     ss << task.name << ".log";
-//     std::string fname = ss.str();
-//     // FIXME: Why oh why is it every file open in append in this
-//     // application?
-//     exec_time_f.open(fname, std::ios_base::app);
-//     if (!exec_time_f) {
-//         LOG(ERROR, "execution time file '%s' not created\n", fname.c_str());
-//         exit(EXIT_FAILURE);
-//     }
-//     // the 1st line is the task relative deadline. all the following lines
-//     // are actual execution times
-//     exec_time_f << task.sched.deadline << '\n';
-// }
-
 // ------------------------- MEMBER FUNCTIONS -------------------------- //
 
 void Task::task_body() {
+    // Pin before do_init(), so that the task data is allocated on the right
+    // NUMA node
+    common_pin();
+    timeline.init(dag.num_activations);
     do_init();
     common_init();
 
     for (int i = 0; i < dag.num_activations; ++i) {
-        std::chrono::microseconds before, after, duration;
-
+        // Sets the release and input timestamps
         loop_body_before(i);
-        before = std::chrono::microseconds(micros());
 
+        if (perf.enabled()) {
+            perf.start();
+        }
+
+        job_record &job = timeline.next();
+        job.start = timesource_now_ns();
+        RTDAG_PROBE2(compute_start, name.c_str(), i);
         do_loop_work(i);
-        after = std::chrono::microseconds(micros());
-        duration = after - before;
+        job.end = timesource_now_ns();
+        RTDAG_PROBE3(compute_end, name.c_str(), i, job.end - job.start);
 
-        loop_body_after(i, duration);
+        if (perf.enabled()) {
+            perf.stop(i);
+        }
+
+        // Sets the publish timestamp and commits the job
+        loop_body_after(i);
     }
 
     common_exit();
@@ -125,21 +128,33 @@ void align_deadlines(period_info &pinfo) {
         pinfo.next_period.tv_sec, pinfo.next_period.tv_nsec);
 }
 
-void Task::common_init() {
+void Task::common_pin() {
     task_set_name(name);
 
     if (cpu >= 0) {
         task_pin(cpu);
     }
+}
 
+void Task::common_init() {
     // task_clean_buffers(data);
 
     scheduling.set();
 
+    // Opened by the task thread itself, they count only its own events
+    if (perf_counters) {
+        perf.open(name, dag.num_activations);
+    }
+
     wait_on_barrier(dag.barrier, name);
 
     if (is_originator()) {
         period_init(pinfo, dag.period);
+        if (dag.release_timerfd && pinfo_use_timerfd(&pinfo)) {
+            std::fprintf(stderr, "ERROR: could not create the timerfd: %s\n",
+                         std::strerror(errno));
+            exit(EXIT_FAILURE);
+        }
     }
 
     wait_on_barrier(dag.barrier, name);
@@ -175,7 +190,29 @@ void wait_incoming_messages(Task &task, int iter) {
         // can just wait on the first one
         //
         // FIXME: remove the size argument from the pop
-        task.in_buffers[0]->mq.pop(NULL, task.in_buffers.size());
+        constexpr int max_elems =
+            std::numeric_limits<MultiQueue::mask_type>::digits;
+        std::array<void *, max_elems> elems;
+        std::array<u64, max_elems> pushed;
+        task.in_buffers[0]->mq.pop(elems.data(), task.in_buffers.size(),
+                                   pushed.data());
+        RTDAG_PROBE3(pop_return, task.name.c_str(), iter,
+                     task.in_buffers.size());
+
+        // Running again, with all the inputs
+        const u64 now = timesource_now_ns();
+        Edge *last = task.in_buffers[0];
+        for (Edge *edge : task.in_buffers) {
+            edge->handoff_hist->record(now - pushed[edge->push_idx]);
+            if (pushed[edge->push_idx] > pushed[last->push_idx]) {
+                last = edge;
+            }
+        }
+        last->wakeup_hist->record(now - pushed[last->push_idx]);
+
+        // Each producer pushes the release time of the activation (all the
+        // same)
+        task.release_ns = reinterpret_cast<uintptr_t>(elems[0]);
 
         // Check that all the buffers have sent the right amount of data
         for (size_t i = 0; i < task.in_buffers.size(); ++i) {
@@ -205,8 +242,18 @@ void Task::loop_body_before(int iter) {
     // and read at the end of each period by the sink, to calculate overall
     // response time.
 
+    // As soon as possible after the wakeup, for the originator
+    const u64 woken_ns = timesource_now_ns();
+
     if (is_originator()) {
+        dag.activation.store(iter, std::memory_order_relaxed);
+
         std::chrono::microseconds now = get_next_period(&pinfo);
+        release_ns = SEC_TO_NSEC(u64(pinfo.next_period.tv_sec)) +
+                     pinfo.next_period.tv_nsec;
+        dag.release_jitter_hist.record(
+            woken_ns > release_ns ? woken_ns - release_ns : 0);
+        RTDAG_PROBE4(release, name.c_str(), iter, release_ns, woken_ns);
 
         // HACK: this is a terrible idea and it should be fixed!!
         dag.start_time.push(0, (void *)now.count());
@@ -216,6 +263,13 @@ void Task::loop_body_before(int iter) {
     }
 
     wait_incoming_messages(*this, iter);
+
+    job_record &job = timeline.next();
+    job.iter = iter;
+    job.release = release_ns;
+
+    // The originator has no inputs, its input - release is the jitter
+    job.input = is_originator() ? woken_ns : timesource_now_ns();
 }
 
 void write_to_queue(const char *from, int iter, char *buffer, int size) {
@@ -239,16 +293,17 @@ void write_to_queue(const char *from, int iter, char *buffer, int size) {
 #endif
 }
 
-void Task::loop_body_after(int iter, std::chrono::microseconds duration) {
+void Task::loop_body_after(int iter) {
     // Push the values into each queue
     for (size_t i = 0; i < out_buffers.size(); ++i) {
         write_to_queue(name.c_str(), iter, out_buffers[i]->msg.data(),
                        out_buffers[i]->msg.size());
 
-        // The values pushed in the multi-queue are meaningless, on the
-        // read side we always go check the ->msg content anyway...
+        // The content is in ->msg, the value pushed in the multi-queue is
+        // the release time of the activation (see wait_incoming_messages())
         out_buffers[i]->mq.push(out_buffers[i]->push_idx,
-                                out_buffers[i]->msg.data());
+                                reinterpret_cast<void *>(uintptr_t(release_ns)));
+        RTDAG_PROBE3(push, name.c_str(), iter, out_buffers[i]->to);
 
         // To avoid printing too many characters if the buffer is very
         // long, we limit to the first 50 characters.
@@ -258,17 +313,22 @@ void Task::loop_body_after(int iter, std::chrono::microseconds duration) {
             strlen(out_buffers[i]->msg.data()), out_buffers[i]->msg.data());
     }
 
-#ifndef NDEBUG
-    // FIXME: implement this stuff as well
-
-    // write the task execution time into its log file
-    exec_time_f << duration << endl;
-    if (duration > task.deadline) {
-        printf("ERROR: task %s (%u): task duration %lu > deadline %lu!\n",
-               task_name, iter, duration, task.deadline);
-        // TODO: stop or continue ?
+    job_record &job = timeline.next();
+    job.publish = timesource_now_ns();
+    const u64 response_ns = job.publish - job.release;
+    const u64 exec_ns = job.end - job.start;
+    exec_hist.record(exec_ns);
+    response_hist.record(response_ns);
+
+    const u64 deadline_ns = scheduling.deadline().count();
+    const bool missed = deadline_ns > 0 && exec_ns > deadline_ns;
+    if (missed) {
+        RTDAG_PROBE4(deadline_miss, name.c_str(), iter, exec_ns, deadline_ns);
     }
-#endif // NDEBUG
+    // The originator wakes up on another clock, possibly before the release
+    const u64 wait_ns = job.input > job.release ? job.input - job.release : 0;
+    livestats_job(live, exec_ns, wait_ns, missed);
+    timeline.commit();
 
     if (is_sink()) {
         s64 last_dag_start;
@@ -276,8 +336,9 @@ void Task::loop_body_after(int iter, std::chrono::microseconds duration) {
         // FIXME: there's something seriously wrong here
         dag.start_time.pop((void **)&last_dag_start, 1);
 
-        duration = std::chrono::microseconds(micros()) -
-                   std::chrono::microseconds(last_dag_start);
+        const std::chrono::microseconds duration =
+            std::chrono::microseconds(micros()) -
+            std::chrono::microseconds(last_dag_start);
 
         LOG(INFO, "task %s (%u): dag duration %lu us = %lu ms = %lu s\n\n",
             name.c_str(), iter, duration.count(),
@@ -285,7 +346,18 @@ void Task::loop_body_after(int iter, std::chrono::microseconds duration) {
                 .count(),
             std::chrono::duration_cast<std::chrono::seconds>(duration).count());
 
-        dag.response_times[iter] = duration;
+        dag.response_hist.record(response_ns);
+
+        const u64 e2e_ns =
+            std::chrono::nanoseconds(dag.e2e_deadline).count();
+        if (response_ns > e2e_ns) {
+            RTDAG_PROBE4(dag_deadline_miss, name.c_str(), iter, response_ns,
+                         e2e_ns);
+        }
+        livestats_activation(dag.live, response_ns, response_ns > e2e_ns);
+        if (dag.raw_response_times) {
+            dag.response_times[iter] = duration;
+        }
 
         if (duration > dag.e2e_deadline) {
             // we do expect a few deadline misses, despite all
@@ -322,11 +394,18 @@ std::fstream open_append(const std::string &fname, bool &existed) {
 }
 
 void Task::common_exit() {
-#ifndef NDEBUG
-    exec_time_f.close();
-#endif // NDEBUG
+    if (is_originator()) {
+        pinfo_destroy(&pinfo);
+
+        const LogHistogram &jitter = dag.release_jitter_hist;
+        printf("[%s] release jitter (%s): mean %.3f us, p99 %.3f us, max "
+               "%.3f us\n",
+               name.c_str(), dag.release_timerfd ? "timerfd" : "nanosleep",
+               jitter.mean() / 1000, jitter.percentile(99) / 1000.,
+               jitter.max() / 1000.);
+    }
 
-    if (is_sink()) {
+    if (is_sink() && dag.raw_response_times) {
         // FIXME: change this to avoid creating the output directory
         std::stringstream ss;
         ss << dag.name << "/" << dag.name << ".log";
@@ -374,3 +453,81 @@ void Task::print(std::ostream &os) {
     }
     os << '\n';
 }
+
+void Task::write_timeline() {
+    // TODO: this is not the correct way in C++ to build a valid path!
+    const std::string fname = dag.name + "/" + name + ".timeline.csv";
+    if (!timeline.write_csv(fname)) {
+        LOG(ERROR, "timeline file '%s' not created\n", fname.c_str());
+    }
+
+    if (perf.enabled()) {
+        const std::string perf_fname = dag.name + "/" + name + ".perf.csv";
+        if (!perf.write_csv(perf_fname)) {
+            LOG(ERROR, "perf counters file '%s' not created\n",
+                perf_fname.c_str());
+        }
+    }
+}
+
+void GaussTask::adapt_ticks(s32 iter, u64 demand_us, u64 measured_us) {
+    if (demand_us == 0 || measured_us == 0) {
+        return;
+    }
+
+    // The value that would have made this job last exactly its demand
+    const float estimate = ticks_per_us * float(demand_us) / measured_us;
+    const float lo = ticks_per_us_initial * (1 - adaptation.bound);
+    const float hi = ticks_per_us_initial * (1 + adaptation.bound);
+
+    const float previous = ticks_per_us;
+    ticks_per_us = std::clamp(
+        previous + adaptation.gain * (estimate - previous), lo, hi);
+
+    if (ticks_per_us != previous) {
+        adjustments.push_back({iter, demand_us, measured_us, ticks_per_us});
+        LOG(DEBUG, "task %s (%u): ticks_per_us %f -> %f\n", name.c_str(), iter,
+            previous, ticks_per_us);
+    }
+}
+
+void GaussTask::write_adjustments() {
+    // TODO: this is not the correct way in C++ to build a valid path!
+    const std::string fname = dag.name + "/" + name + ".ticks.csv";
+    std::ofstream os(fname);
+    if (!os) {
+        LOG(ERROR, "ticks adjustments file '%s' not created\n", fname.c_str());
+        return;
+    }
+
+    os << "iter,demand_us,measured_us,ticks_per_us\n";
+    for (const auto &adj : adjustments) {
+        os << adj.iter << ',' << adj.demand_us << ',' << adj.measured_us << ','
+           << adj.ticks_per_us << '\n';
+    }
+}
+
+void GaussTask::account_error(u64 demand_us, u64 measured_us) {
+    const s64 err = s64(measured_us) - s64(demand_us);
+    const u64 abs_err = err < 0 ? -err : err;
+
+    error.jobs++;
+    error.demand_us += demand_us;
+    error.sum_us += err;
+    error.sum_abs_us += abs_err;
+    error.max_abs_us = std::max(error.max_abs_us, abs_err);
+}
+
+void GaussTask::report_error() const {
+    if (error.jobs == 0) {
+        return;
+    }
+
+    const double mean = double(error.sum_us) / error.jobs;
+    const double mean_demand = double(error.demand_us) / error.jobs;
+    printf("[%s] %lu jobs, mean demand %.1f us: error mean %+.1f us (%+.2f%%), "
+           "mean abs %.1f us, max abs %lu us\n",
+           name.c_str(), error.jobs, mean_demand, mean,
+           mean_demand > 0 ? 100 * mean / mean_demand : 0.0,
+           double(error.sum_abs_us) / error.jobs, error.max_abs_us);
+}
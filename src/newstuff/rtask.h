@@ -1,17 +1,26 @@
 #ifndef RTDAG_TASK_H
 #define RTDAG_TASK_H
 
+#include <atomic>
 #include <barrier>
 #include <chrono>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "input_base.h"
 #include "multi_queue.h"
+#include "newstuff/exectrace.h"
+#include "newstuff/histogram.h"
+#include "newstuff/livestats.h"
+#include "newstuff/perfcounters.h"
 #include "newstuff/schedutils.h"
+#include "newstuff/timeline.h"
 #include "periodic_task.h"
+#include "rtbuffer.h"
 #include "rtdag_calib.h"
-#include "rtgauss.h"
+#include "rtkernel.h"
 
 struct Edge {
     const int from;
@@ -20,8 +29,23 @@ struct Edge {
     MultiQueue &mq;
     std::vector<char> msg;
 
+    // Recorded by the consumer when it runs after receiving all its inputs,
+    // in ns (see wait_incoming_messages()):
+    //  - handoff: since the push of the message on this edge;
+    //  - wakeup:  since the push that completed the inputs, only when it was
+    //             the one on this edge.
+    // Using unique_ptr because LogHistogram is not movable.
+    std::unique_ptr<LogHistogram> handoff_hist;
+    std::unique_ptr<LogHistogram> wakeup_hist;
+
     Edge(MultiQueue &mq, int from, int to, int push_idx, int msg_size) :
-        from(from), to(to), push_idx(push_idx), mq(mq), msg(msg_size, '.') {
+        from(from),
+        to(to),
+        push_idx(push_idx),
+        mq(mq),
+        msg(msg_size, '.'),
+        handoff_hist(std::make_unique<LogHistogram>()),
+        wakeup_hist(std::make_unique<LogHistogram>()) {
 
         // The message is initialized with '.' (above) and a termination
         // string character. This is to avoid errors when checking that the
@@ -51,18 +75,38 @@ public:
     // The edge connections between tasks (reference the in_queues above)
     std::vector<Edge> edges;
 
-    // All the response times
+    // All the response times, only if raw_response_times (otherwise only
+    // their histogram is kept, in constant memory)
+    const bool raw_response_times;
     std::vector<std::chrono::microseconds> response_times;
 
+    // The response times of the DAG, in ns (recorded by the sink)
+    LogHistogram response_hist;
+
+    // How the originator waits for the releases, and how late it actually
+    // runs after each of them, in ns
+    const bool release_timerfd;
+    LogHistogram release_jitter_hist;
+
+    // The live counters of the DAG, updated by the sink (NULL if disabled,
+    // see livepublisher.h)
+    livestats_dag *live = nullptr;
+
+    // The index of the current activation, set by the originator when it
+    // starts (-1 before the first one)
+    std::atomic<s64> activation = -1;
+
     Dag(const std::string &name, std::chrono::microseconds period,
         std::chrono::microseconds e2e_deadline, s64 num_activations,
-        s32 ntasks) :
+        s32 ntasks, bool raw_response_times, bool release_timerfd) :
         name(name),
         period(period),
         e2e_deadline(e2e_deadline),
         num_activations(num_activations),
         barrier(ntasks),
-        response_times(num_activations) {}
+        raw_response_times(raw_response_times),
+        response_times(raw_response_times ? num_activations : 0),
+        release_timerfd(release_timerfd) {}
 };
 
 class Task {
@@ -79,6 +123,30 @@ public:
 
     period_info pinfo;
 
+    // The timestamps of the jobs, written to <dag>/<task>.timeline.csv by
+    // write_timeline() after the run
+    JobTimeline timeline;
+
+    // The nominal release time of the DAG activation of the current job (in
+    // ns), set by the originator and passed along the edges with the
+    // messages
+    u64 release_ns = 0;
+
+    // The execution (computation only) and response (from the release of
+    // the DAG activation to the publishing of the outputs) times of the
+    // jobs, in ns
+    LogHistogram exec_hist;
+    LogHistogram response_hist;
+
+    // The performance counters of the computation of the jobs (if
+    // perf_counters and available), written to <dag>/<task>.perf.csv by
+    // write_timeline() after the run
+    const bool perf_counters;
+    PerfCounters perf;
+
+    // The live counters of the task (NULL if disabled, see livepublisher.h)
+    livestats_task *live = nullptr;
+
 #if RTDAG_MEM_ACCESS == ON
     // This volatile variable is used to avoid optimizing away all the
     // memory operations.
@@ -87,9 +155,10 @@ public:
 
 private:
     void task_body();
+    void common_pin();
     void common_init();
     void loop_body_before(int iter);
-    void loop_body_after(int iter, std::chrono::microseconds duration);
+    void loop_body_after(int iter);
     void common_exit();
 
 protected:
@@ -100,14 +169,16 @@ protected:
 public:
     Task(Dag &dag, const std::string &name, const std::string &type,
          const sched_info &scheduling, int cpu,
-         const std::vector<Edge *> &in_edges, std::vector<Edge *> out_edges) :
+         const std::vector<Edge *> &in_edges, std::vector<Edge *> out_edges,
+         bool perf_counters) :
         dag(dag),
         name(name),
         type(type),
         scheduling(scheduling),
         cpu(cpu),
         in_buffers(in_edges),
-        out_buffers(out_edges) {}
+        out_buffers(out_edges),
+        perf_counters(perf_counters) {}
 
     virtual ~Task() = default;
 
@@ -125,69 +196,137 @@ public:
     }
 
     void print(std::ostream &os);
+
+    // Writes the job timeline and the performance counters (if any). Must be
+    // called only after the task thread has terminated.
+    void write_timeline();
 };
 
+// A task that emulates its computation by repeating the ticks of a workload
+// kernel (see rtkernel.h) for its whole WCET, or for the per-job demand
+// replayed from an execution-time trace (if any).
+//
+// If adaptation is enabled, after each job the task compares the demand with
+// the CPU time actually spent by its thread and moves ticks_per_us by a
+// fraction (gain) of the error, never farther than bound (relative) from the
+// initial value. All the adjustments are written to <dag>/<task>.ticks.csv.
 class GaussTask : public Task {
     // TODO: review all the types
     const u64 wcet;
-    const float ticks_per_us;
-
+    float ticks_per_us;
+
+    const float ticks_per_us_initial;
+    const ticks_adaptation adaptation;
+
+    struct ticks_adjustment {
+        s32 iter;
+        u64 demand_us;
+        u64 measured_us;
+        float ticks_per_us;
+    };
+    std::vector<ticks_adjustment> adjustments;
+
+    // Achieved vs requested execution time of the jobs (in thread CPU time)
+    struct {
+        u64 jobs = 0;
+        u64 demand_us = 0;
+        s64 sum_us = 0;
+        u64 sum_abs_us = 0;
+        u64 max_abs_us = 0;
+    } error;
+
+    ExecTrace trace;
+
+    const rtkernel *kernel;
     const s32 matrix_size;
     const s32 omp_target;
+    const std::vector<int> omp_cpus;
 
 public:
-    GaussTask(Dag &dag, const std::string &name, const std::string &type,
+    GaussTask(Dag &dag, const std::string &name, const rtkernel *kernel,
               const sched_info &scheduling, int cpu,
               const std::vector<Edge *> &in_edges,
               std::vector<Edge *> out_edges, std::chrono::microseconds wcet,
-              u64 expected_wcet_ratio, float ticks_per_us, s32 matrix_size,
-              s32 omp_target) :
-        Task(dag, name, type, scheduling, cpu, in_edges, out_edges),
+              float expected_wcet_ratio, float ticks_per_us, s32 matrix_size,
+              s32 omp_target, const std::vector<int> &omp_cpus,
+              const ExecTrace &trace, const ticks_adaptation &adaptation,
+              bool perf_counters) :
+        Task(dag, name, kernel->name, scheduling, cpu, in_edges, out_edges,
+             perf_counters),
         wcet(wcet.count() * expected_wcet_ratio),
         ticks_per_us(ticks_per_us),
+        ticks_per_us_initial(ticks_per_us),
+        adaptation(adaptation),
+        trace(trace),
+        kernel(kernel),
         matrix_size(matrix_size),
-        omp_target(omp_target) {}
-
-    virtual rtgauss_type get_rtgauss_type() const = 0;
+        omp_target(omp_target),
+        omp_cpus(omp_cpus) {}
 
     void do_init() override {
-        rtgauss_init(matrix_size, get_rtgauss_type(), omp_target);
+        rtkernel_params params{matrix_size, omp_target, omp_cpus.data(),
+                               int(omp_cpus.size()),
+                               int(scheduling.priority())};
+        if (rtkernel_init(kernel, &params)) {
+            LOG(ERROR, "task %s: could not initialize kernel %s!\n",
+                name.c_str(), kernel->name);
+            exit(EXIT_FAILURE);
+        }
+
+        // Read the whole trace now, jobs will only index it
+        if (trace.enabled()) {
+            trace.load(dag.num_activations);
+        }
+
+        if (adaptation.gain > 0) {
+            adjustments.reserve(dag.num_activations);
+        }
 
         // Pre-load code on the CPU/GPU/... for fast execution later on!
         int retv = waste_calibrate(); // FIXME: implement it differently!!
         (void)retv;
         LOG(DEBUG, "Waste calibrate value %d\n", retv);
+
+        // Where the kernel data actually landed
+        rtbuffer_report(name.c_str());
     }
 
     void do_loop_work(int iter) override {
+        const u64 demand = trace.enabled() ? trace.at(iter) : wcet;
         LOG(INFO, "task %s (%u): running the processing step for %lu * %f\n",
-            name.c_str(), iter, wcet, ticks_per_us);
-        Count_Time_Ticks(wcet, ticks_per_us);
+            name.c_str(), iter, demand, ticks_per_us);
+
+        const u64 before = thread_micros();
+#if RTDAG_COUNT_TICK != ON
+        // Busy-wait on the time source instead (see timesource.h)
+        Count_Time(demand);
+        const u64 measured = thread_micros() - before;
+#else
+        Count_Time_Hybrid(demand, ticks_per_us);
+        const u64 measured = thread_micros() - before;
+
+        if (adaptation.gain > 0) {
+            adapt_ticks(iter, demand, measured);
+        }
+#endif
+        account_error(demand, measured);
     }
 
     void do_exit() override {
-        // Do nothing is fine
-    }
-};
-
-class CPUTask : public GaussTask {
-public:
-    using GaussTask::GaussTask;
+        rtkernel_teardown();
+        report_error();
 
-    rtgauss_type get_rtgauss_type() const override {
-        return RTGAUSS_CPU;
+        if (adaptation.gain > 0) {
+            write_adjustments();
+        }
     }
-};
 
-#if RTGAUSS_OMP_SUPPORT == ON
-class OMPTask : public GaussTask {
-public:
-    using GaussTask::GaussTask;
+private:
+    void adapt_ticks(s32 iter, u64 demand_us, u64 measured_us);
+    void write_adjustments();
 
-    rtgauss_type get_rtgauss_type() const override {
-        return RTGAUSS_OMP;
-    }
+    void account_error(u64 demand_us, u64 measured_us);
+    void report_error() const;
 };
-#endif
 
 #endif // RTDAG_TASK_H
@@ -0,0 +1,139 @@
+#include "newstuff/stats.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cerrno>
+#include <chrono>
+#include <map>
+#include <utility>
+#include <cstring>
+
+#include "logging.h"
+#include "time_aux.h"
+
+// The percentiles in each line, after count and mean
+static constexpr double stats_percentiles[] = {50, 90, 99, 99.9, 99.99, 99.999};
+
+// ------------------------- HELPER FUNCTIONS -------------------------- //
+
+static inline double to_us(double ns) {
+    return ns / 1000;
+}
+
+// ------------------------- MEMBER FUNCTIONS -------------------------- //
+
+StatsExporter::StatsExporter(const statistics_info &info,
+                             const std::string &fname, const Dag &dag,
+                             const std::vector<std::unique_ptr<Task>> &tasks) :
+    info(info),
+    fname(fname),
+    dag(dag),
+    tasks(tasks) {}
+
+StatsExporter::~StatsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_requested = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void StatsExporter::start() {
+    os.open(fname);
+    if (!os) {
+        LOG(ERROR, "statistics file '%s' not created\n", fname.c_str());
+        return;
+    }
+
+    os << "checkpoint,time_us,activation,series,count,mean_us";
+    for (double p : stats_percentiles) {
+        os << ",p" << p << "_us";
+    }
+    os << ",max_us\n";
+
+    if (info.checkpoint == 0) {
+        return;
+    }
+
+    stop_requested = false;
+    thread = std::thread(&StatsExporter::body, this);
+}
+
+void StatsExporter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stop_requested = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    if (os.is_open()) {
+        write("final");
+        os.close();
+    }
+}
+
+void StatsExporter::body() {
+    pthread_setname_np(pthread_self(), "stats");
+
+    struct sched_param param = {};
+    if (sched_setscheduler(0, SCHED_IDLE, &param)) {
+        LOG(WARNING, "could not set the statistics policy: %s\n",
+            std::strerror(errno));
+    }
+
+    const auto period = std::chrono::microseconds(info.checkpoint);
+    std::unique_lock<std::mutex> lock(mtx);
+    while (!cv.wait_for(lock, period, [this] { return stop_requested; })) {
+        write(std::to_string(checkpoints++));
+    }
+}
+
+void StatsExporter::write(const std::string &checkpoint) {
+    const u64 now = micros();
+    const s64 activation = dag.activation.load(std::memory_order_relaxed);
+
+    const auto line = [&](const std::string &series,
+                          const LogHistogram &hist) {
+        os << checkpoint << ',' << now << ',' << activation << ',' << series
+           << ',' << hist.count() << ',' << to_us(hist.mean());
+        for (double p : stats_percentiles) {
+            os << ',' << to_us(hist.percentile(p));
+        }
+        os << ',' << to_us(hist.max()) << '\n';
+    };
+
+    line("dag.response", dag.response_hist);
+    line("dag.release_jitter", dag.release_jitter_hist);
+    for (const auto &task_ptr : tasks) {
+        line(task_ptr->name + ".exec", task_ptr->exec_hist);
+        line(task_ptr->name + ".response", task_ptr->response_hist);
+    }
+
+    // The wakeups also by the CPUs of the producer and the consumer (as
+    // pinned, unpinned tasks are on cpuany)
+    std::map<std::pair<int, int>, LogHistogram> cpu_pairs;
+    for (const Edge &edge : dag.edges) {
+        const Task &from = *tasks[edge.from];
+        const Task &to = *tasks[edge.to];
+        const std::string prefix = from.name + "->" + to.name;
+        line(prefix + ".handoff", *edge.handoff_hist);
+        line(prefix + ".wakeup", *edge.wakeup_hist);
+        cpu_pairs[{from.cpu, to.cpu}].merge(*edge.wakeup_hist);
+    }
+
+    const auto cpu_name = [](int cpu) {
+        return cpu >= 0 ? "cpu" + std::to_string(cpu) : std::string("cpuany");
+    };
+    for (const auto &[cpus, hist] : cpu_pairs) {
+        line(cpu_name(cpus.first) + "->" + cpu_name(cpus.second) + ".wakeup",
+             hist);
+    }
+    os.flush();
+}
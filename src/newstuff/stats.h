@@ -0,0 +1,56 @@
+#ifndef RTDAG_STATS_H
+#define RTDAG_STATS_H
+
+#include <condition_variable>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "input_base.h"
+#include "newstuff/rtask.h"
+
+// Exports the percentiles of the response time histogram of the DAG, of the
+// execution and response time histograms of each task and of the handoff and
+// wakeup latency histograms of each edge, also aggregated by the pair of CPUs
+// of the producer and the consumer (see histogram.h and rtask.h), to a CSV
+// file, one line per histogram and checkpoint: every
+// statistics_info::checkpoint us while the DAG runs (from a SCHED_IDLE
+// thread, reading the histograms while the tasks record into them) and once
+// at the end. All the values are in us.
+class StatsExporter {
+    statistics_info info;
+    std::string fname;
+    const Dag &dag;
+    const std::vector<std::unique_ptr<Task>> &tasks;
+
+    std::ofstream os;
+    int checkpoints = 0;
+
+    std::thread thread;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stop_requested = false;
+
+public:
+    StatsExporter(const statistics_info &info, const std::string &fname,
+                  const Dag &dag,
+                  const std::vector<std::unique_ptr<Task>> &tasks);
+
+    ~StatsExporter();
+
+    // Opens the file and spawns the checkpoint thread, if enabled
+    void start();
+
+    // Stops the checkpoint thread and writes the final percentiles
+    void stop();
+
+private:
+    void body();
+
+    void write(const std::string &checkpoint);
+};
+
+#endif // RTDAG_STATS_H
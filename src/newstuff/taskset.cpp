@@ -1,7 +1,7 @@
-#include "input.h"
-#include "rtask.h"
+#include "newstuff/taskset.h"
+#include "newstuff/chrometrace.h"
 
-#include <barrier>
+#include <algorithm>
 
 static inline std::vector<int> output_tasks(const input_base &input,
                                             int task_id) {
@@ -69,117 +69,151 @@ void task_single_check(const std::vector<std::unique_ptr<Task>> &tasks,
     }
 }
 
-struct DagTaskset {
-    Dag dag;
-    std::vector<std::unique_ptr<Task>> tasks;
-
-public:
-    DagTaskset(const input_base &input) :
-        dag(input.get_dagset_name(),
-            std::chrono::microseconds(input.get_period()),
-            std::chrono::microseconds(input.get_deadline()),
-            num_activations(std::chrono::microseconds(input.get_hyperperiod()),
-                            std::chrono::microseconds(input.get_period()),
-                            input.get_repetitions()),
-            input.get_n_tasks()) {
-        int ntasks = input.get_n_tasks();
-
-        // Create the in_queues for each task
-        for (int task_id = 0; task_id < ntasks; ++task_id) {
-            int inputs_count = howmany_inputs(input, task_id);
-            if (inputs_count < 1) {
-                inputs_count = 1; // It will not be used, but
-            }
-            dag.in_queues.emplace_back(
-                std::make_unique<MultiQueue>(inputs_count));
+DagTaskset::DagTaskset(const input_base &input) :
+    dag(input.get_dagset_name(),
+        std::chrono::microseconds(input.get_period()),
+        std::chrono::microseconds(input.get_deadline()),
+        num_activations(std::chrono::microseconds(input.get_hyperperiod()),
+                        std::chrono::microseconds(input.get_period()),
+                        input.get_repetitions()),
+        input.get_n_tasks(), input.get_statistics().raw_response_times,
+        input.get_release_timerfd()),
+    interference(input.get_interference()),
+    monitor(input.get_monitor(), dag.name + "/monitor.csv", dag.activation),
+    stats(input.get_statistics(), dag.name + "/" + dag.name + ".stats.csv",
+          dag, tasks),
+    live(input.get_statistics(), dag, tasks) {
+    int ntasks = input.get_n_tasks();
+
+    // Load the additional workload kernels before looking up the tasks
+    // types
+    for (const auto &plugin : input.get_kernel_plugins()) {
+        if (rtkernel_load_plugin(plugin.c_str()) < 0) {
+            exit(EXIT_FAILURE);
         }
+    }
 
-        // All the in_queues are in place, now we can create the edges
-        for (int receiver = 0; receiver < ntasks; ++receiver) {
-            int push_idx = 0;
-            for (int sender = 0; sender < ntasks; ++sender) {
-                int msg_size = input.get_adjacency_matrix(sender, receiver);
-                if (msg_size < 1) {
-                    continue;
-                }
-
-                // There is an edge from sender to receiver of msg_size bytes
-                dag.edges.emplace_back(*dag.in_queues[receiver], sender,
-                                       receiver, push_idx, msg_size);
-
-                push_idx++;
-            }
+    // Create the in_queues for each task
+    for (int task_id = 0; task_id < ntasks; ++task_id) {
+        int inputs_count = howmany_inputs(input, task_id);
+        if (inputs_count < 1) {
+            inputs_count = 1; // It will not be used, but
         }
+        dag.in_queues.emplace_back(
+            std::make_unique<MultiQueue>(inputs_count));
+    }
 
-        // Finally, now that we have all the data, we can create the tasks
-        for (int i = 0; i < ntasks; ++i) {
-            const std::string name = input.get_tasks_name(i);
-            const int cpu = input.get_tasks_affinity(i);
-            sched_info sched_info{
-                input.get_tasks_prio(i),
-                std::chrono::microseconds(input.get_tasks_runtime(i)),
-                std::chrono::microseconds(input.get_tasks_rel_deadline(i)),
-                dag.period};
-
-            std::vector<Edge *> in_edges;
-            std::vector<Edge *> out_edges;
-
-            for (Edge &edge : dag.edges) {
-                if (edge.from == i) {
-                    out_edges.emplace_back(&edge);
-                } else if (edge.to == i) {
-                    in_edges.emplace_back(&edge);
-                }
+    // All the in_queues are in place, now we can create the edges
+    for (int receiver = 0; receiver < ntasks; ++receiver) {
+        int push_idx = 0;
+        for (int sender = 0; sender < ntasks; ++sender) {
+            int msg_size = input.get_adjacency_matrix(sender, receiver);
+            if (msg_size < 1) {
+                continue;
             }
 
-            std::string task_type = input.get_tasks_type(i);
+            // There is an edge from sender to receiver of msg_size bytes
+            dag.edges.emplace_back(*dag.in_queues[receiver], sender,
+                                   receiver, push_idx, msg_size);
 
-            if (task_type == "cpu") {
-                tasks.emplace_back(std::make_unique<CPUTask>(
-                    dag, name, task_type, sched_info, cpu, in_edges, out_edges,
-                    std::chrono::microseconds(input.get_tasks_wcet(i)),
-                    input.get_tasks_expected_wcet_ratio(i),
-                    input.get_ticks_per_us(i), input.get_matrix_size(i),
-                    input.get_omp_target(i)));
-            }
-#if RTDAG_OMP_SUPPORT == ON
-            else if (task_type == "omp") {
-                tasks.emplace_back(std::make_unique<OMPTask>(
-                    dag, name, task_type, sched_info, cpu, in_edges, out_edges,
-                    std::chrono::microseconds(input.get_tasks_wcet(i)),
-                    input.get_tasks_expected_wcet_ratio(i),
-                    input.get_ticks_per_us(i), input.get_matrix_size(i),
-                    input.get_omp_target(i)));
-            }
-#endif
-            // TODO: FRED
-            else {
-                LOG(ERROR, "Unsupported task type %s\n.", task_type.c_str());
+            push_idx++;
+        }
+    }
+
+    // Finally, now that we have all the data, we can create the tasks
+    for (int i = 0; i < ntasks; ++i) {
+        const std::string name = input.get_tasks_name(i);
+        const int cpu = input.get_tasks_affinity(i);
+        sched_info sched_info{
+            input.get_tasks_prio(i),
+            std::chrono::microseconds(input.get_tasks_runtime(i)),
+            std::chrono::microseconds(input.get_tasks_rel_deadline(i)),
+            dag.period};
+
+        std::vector<Edge *> in_edges;
+        std::vector<Edge *> out_edges;
+
+        for (Edge &edge : dag.edges) {
+            if (edge.from == i) {
+                out_edges.emplace_back(&edge);
+            } else if (edge.to == i) {
+                in_edges.emplace_back(&edge);
             }
         }
 
-        const auto is_originator = [](const Task &task) {
-            return task.is_originator();
-        };
+        // TODO: FRED
+        const char *task_type = input.get_tasks_type(i);
+        const rtkernel *kernel = rtkernel_find(task_type);
+        if (kernel == nullptr) {
+            LOG(ERROR, "Unsupported task type %s.\n", task_type);
+            exit(EXIT_FAILURE);
+        }
 
-        const auto is_sink = [](const Task &task) {
-            return task.is_originator();
-        };
+        tasks.emplace_back(std::make_unique<GaussTask>(
+            dag, name, kernel, sched_info, cpu, in_edges, out_edges,
+            std::chrono::microseconds(input.get_tasks_wcet(i)),
+            input.get_tasks_expected_wcet_ratio(i),
+            input.get_ticks_per_us(i), input.get_matrix_size(i),
+            input.get_omp_target(i), input.get_tasks_omp_cpus(i),
+            ExecTrace(input.get_tasks_trace(i),
+                      input.get_tasks_trace_offset(i),
+                      input.get_tasks_trace_scale(i),
+                      input.get_tasks_trace_loop(i)),
+            input.get_ticks_adaptation(), input.get_tasks_perf_counters(i)));
+    }
+
+    const auto is_originator = [](const Task &task) {
+        return task.is_originator();
+    };
 
-        task_single_check(tasks, is_originator, "originator");
-        task_single_check(tasks, is_sink, "sink");
+    const auto is_sink = [](const Task &task) {
+        return task.is_sink();
+    };
+
+    task_single_check(tasks, is_originator, "originator");
+    task_single_check(tasks, is_sink, "sink");
+}
+
+void DagTaskset::print(std::ostream &os) {
+    for (const auto &task_ptr : tasks) {
+        task_ptr->print(os);
     }
+    os.flush();
+}
 
-    void print(std::ostream &os) {
-        for (const auto &task_ptr : tasks) {
-            task_ptr->print(os);
-        }
-        os.flush();
+void DagTaskset::start() {
+    // The monitor calibrates its probes before the interference starts
+    monitor.start();
+    interference.start();
+    stats.start();
+    live.start();
+
+    for (const auto &task_ptr : tasks) {
+        threads.emplace_back(task_ptr->start());
     }
+}
 
-    void start() {
-        for (const auto &task_ptr : tasks) {
-            task_ptr->start();
-        }
+void DagTaskset::join() {
+    for (auto &thread : threads) {
+        thread.join();
     }
-};
+    threads.clear();
+
+    // The background load must not slow down the output below
+    monitor.stop();
+    interference.stop();
+
+    stats.stop();
+    live.stop();
+
+    // Only now, not to disturb the tasks that are still running
+    for (const auto &task_ptr : tasks) {
+        task_ptr->write_timeline();
+    }
+
+    // TODO: this is not the correct way in C++ to build a valid path!
+    const std::string fname = dag.name + "/" + dag.name + ".trace.json";
+    if (!write_chrome_trace(dag, tasks, fname)) {
+        LOG(ERROR, "trace file '%s' not created\n", fname.c_str());
+    }
+}
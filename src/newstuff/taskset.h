@@ -0,0 +1,54 @@
+#ifndef RTDAG_TASKSET_H
+#define RTDAG_TASKSET_H
+
+#include <memory>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#include "input_base.h"
+#include "newstuff/interference.h"
+#include "newstuff/livepublisher.h"
+#include "newstuff/monitor.h"
+#include "newstuff/rtask.h"
+#include "newstuff/stats.h"
+
+struct DagTaskset {
+    Dag dag;
+    std::vector<std::unique_ptr<Task>> tasks;
+
+    // Background load started and stopped together with the DAG
+    InterferenceSet interference;
+
+    // Samples the platform state while the DAG runs, into
+    // <dag_name>/monitor.csv
+    Monitor monitor;
+
+    // Percentiles of the response and execution times, into
+    // <dag_name>/<dag_name>.stats.csv
+    StatsExporter stats;
+
+    // Live counters in shared memory, for rtdag-top
+    LivePublisher live;
+
+    // One per task, while the DAG is running
+    std::vector<std::thread> threads;
+
+public:
+    DagTaskset(const input_base &input);
+
+    void print(std::ostream &os);
+
+    // Starts the monitor (once its probes are calibrated), the interference
+    // threads, the statistics checkpoints and the live statistics (if any)
+    // and all the tasks of the DAG
+    void start();
+
+    // Waits for all the tasks of the DAG to complete their activations, then
+    // stops the interference threads and the monitor, and writes the final
+    // statistics and the job timelines (also as a Chrome trace, see
+    // chrometrace.h)
+    void join();
+};
+
+#endif // RTDAG_TASKSET_H
@@ -0,0 +1,31 @@
+#include "newstuff/timeline.h"
+
+#include <algorithm>
+#include <bit>
+#include <fstream>
+
+void JobTimeline::init(s64 jobs) {
+    const u64 size = std::bit_ceil(
+        u64(std::clamp<s64>(jobs, 1, TIMELINE_MAX_JOBS)));
+
+    // Value-initialized, so every page is touched now
+    ring.assign(size, job_record{});
+    mask = size - 1;
+    head = 0;
+}
+
+bool JobTimeline::write_csv(const std::string &fname) const {
+    std::ofstream os(fname);
+    if (!os) {
+        return false;
+    }
+
+    os << "iter,release_ns,input_ns,start_ns,end_ns,publish_ns\n";
+    for_each([&os](const job_record &job) {
+        os << job.iter << ',' << job.release << ',' << job.input << ','
+           << job.start << ',' << job.end << ',' << job.publish << '\n';
+    });
+
+    os.flush();
+    return bool(os);
+}
@@ -0,0 +1,79 @@
+#ifndef RTDAG_TIMELINE_H
+#define RTDAG_TIMELINE_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "newstuff/integers.h"
+
+// The timestamps of a job of a task, in ns on the CLOCK_MONOTONIC time base
+// (see timesource.h). They split the response time of each node into:
+//  - waiting:   input - release, for the predecessors and their messages;
+//  - dispatch:  start - input;
+//  - execution: end - start, including the interference (preemptions) on it;
+//  - publish:   publish - end, to push the output messages.
+struct job_record {
+    s64 iter;
+
+    // The nominal release of the DAG activation (set by the originator)
+    u64 release;
+
+    // All the input messages have been received (for the originator, it
+    // woke up for the release, so this is the release jitter)
+    u64 input;
+
+    // The computation started and finished
+    u64 start;
+    u64 end;
+
+    // All the output messages have been pushed
+    u64 publish;
+};
+
+// Fixed-size ring of job records, filled by the thread of a single task with
+// no locks and no system calls. When it is full the oldest records are
+// overwritten. Records are written in place, then made visible to readers by
+// commit().
+class JobTimeline {
+    std::vector<job_record> ring;
+    u64 mask = 0;
+    std::atomic<u64> head = 0;
+
+public:
+    // Allocates (and touches) room for the given number of jobs, rounded up
+    // to a power of two and capped at TIMELINE_MAX_JOBS. Must be called by
+    // the thread that fills the ring, after pinning it, so that the ring is
+    // allocated on the right NUMA node.
+    void init(s64 jobs);
+
+    // The record of the job in progress
+    inline job_record &next() {
+        return ring[head.load(std::memory_order_relaxed) & mask];
+    }
+
+    inline void commit() {
+        head.store(head.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    // Calls f on all the committed records still in the ring, oldest first
+    template <typename F>
+    void for_each(F f) const {
+        const u64 last = head.load(std::memory_order_acquire);
+        const u64 first = last > ring.size() ? last - ring.size() : 0;
+        for (u64 i = first; i < last; ++i) {
+            f(ring[i & mask]);
+        }
+    }
+
+    // Writes all the committed records still in the ring to a CSV file.
+    // Returns false on error.
+    bool write_csv(const std::string &fname) const;
+};
+
+// Beyond this, a ring keeps only the most recent jobs (it takes 48 bytes per
+// job)
+#define TIMELINE_MAX_JOBS (1 << 20)
+
+#endif // RTDAG_TIMELINE_H
@@ -0,0 +1,42 @@
+#ifndef RTDAG_USDT_H
+#define RTDAG_USDT_H
+
+// USDT (SystemTap-style) static tracepoints of the "rtdag" provider, for
+// external tools such as bpftrace, perf or bcc. Each one compiles to a single
+// nop plus a note in the ELF file, arguments are only placed in registers or
+// on the stack. When RTDAG_USDT is off, or sys/sdt.h is not available
+// (systemtap-sdt-dev on Debian/Ubuntu, systemtap-sdt-devel on Fedora), they
+// compile to nothing and their arguments are not evaluated.
+//
+// The probes (names as seen by the tools) and their arguments:
+//  - release(task, iter, release_ns, woken_ns): the originator woke up for
+//    the release of an activation;
+//  - pop_return(task, iter, ninputs): a task received all its inputs;
+//  - compute_start(task, iter), compute_end(task, iter, duration_ns);
+//  - push(task, iter, to): a task pushed its message to task index "to";
+//  - deadline_miss(task, iter, duration_ns, deadline_ns): the computation of
+//    a job exceeded the relative deadline of its task;
+//  - dag_deadline_miss(task, iter, response_ns, deadline_ns): the sink
+//    completed an activation after the end-to-end deadline.
+// The task argument is a NUL-terminated string, times are in ns on the
+// CLOCK_MONOTONIC time base (see timesource.h).
+
+#if RTDAG_USDT == ON && __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+
+#define RTDAG_PROBE2(name, a, b) DTRACE_PROBE2(rtdag, name, a, b)
+#define RTDAG_PROBE3(name, a, b, c) DTRACE_PROBE3(rtdag, name, a, b, c)
+#define RTDAG_PROBE4(name, a, b, c, d) DTRACE_PROBE4(rtdag, name, a, b, c, d)
+#else
+#define RTDAG_PROBE2(name, a, b)                                               \
+    do {                                                                       \
+    } while (0)
+#define RTDAG_PROBE3(name, a, b, c)                                            \
+    do {                                                                       \
+    } while (0)
+#define RTDAG_PROBE4(name, a, b, c, d)                                         \
+    do {                                                                       \
+    } while (0)
+#endif
+
+#endif // RTDAG_USDT_H
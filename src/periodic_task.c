@@ -1,6 +1,10 @@
 
 #include "periodic_task.h"
 
+#include <stdint.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
 static void inc_period(struct period_info *pinfo, long delta_ns) 
 {
 	// add microseconds to timespecs nanosecond counter
@@ -16,13 +20,40 @@ static void inc_period(struct period_info *pinfo, long delta_ns)
 void pinfo_init(struct period_info *pinfo, long period_ns)
 {
 	pinfo->period_ns = period_ns;
+	pinfo->timer_fd = -1;
 	clock_gettime(CLOCK_MONOTONIC, &(pinfo->next_period));
 }
 
+int pinfo_use_timerfd(struct period_info *pinfo)
+{
+	pinfo->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	return pinfo->timer_fd < 0 ? -1 : 0;
+}
+
+void pinfo_destroy(struct period_info *pinfo)
+{
+	if (pinfo->timer_fd >= 0) {
+		close(pinfo->timer_fd);
+		pinfo->timer_fd = -1;
+	}
+}
+
 void pinfo_sum_and_wait(struct period_info *pinfo, long delta_ns)
 {
 	inc_period(pinfo, delta_ns);
 
+	if (pinfo->timer_fd >= 0) {
+		/* one-shot, it expires right away if the release is past */
+		struct itimerspec its = { .it_value = pinfo->next_period };
+		uint64_t expirations;
+		if (timerfd_settime(pinfo->timer_fd, TFD_TIMER_ABSTIME, &its, NULL) == 0) {
+			/* for simplicity, ignoring possibilities of signal wakes */
+			ssize_t ret = read(pinfo->timer_fd, &expirations, sizeof(expirations));
+			(void) ret;
+		}
+		return;
+	}
+
 	/* for simplicity, ignoring possibilities of signal wakes */
 	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &pinfo->next_period, NULL);
 }
@@ -33,10 +33,17 @@ extern "C" {
 struct period_info {
         struct timespec next_period;
         long period_ns;
+        int timer_fd; // -1 to wait with clock_nanosleep
 };
 
 void pinfo_init(struct period_info *pinfo, long period_ns);
 
+// Waits on a timerfd (armed at each absolute release) instead of
+// clock_nanosleep, returns -1 (and sets errno) if it cannot be created
+int pinfo_use_timerfd(struct period_info *pinfo);
+
+void pinfo_destroy(struct period_info *pinfo);
+
 void pinfo_sum_period_and_wait(struct period_info *pinfo);
 
 void pinfo_sum_and_wait(struct period_info *pinfo, long delta_ns);
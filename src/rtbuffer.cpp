@@ -0,0 +1,102 @@
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "rtbuffer.h"
+
+// Buffers at least this large are aligned to (and advised as) huge pages
+static constexpr size_t RTBUFFER_HUGE_PAGE = 2 << 20;
+static constexpr size_t RTBUFFER_CACHE_LINE = 64;
+
+// The buffers allocated by each thread, with their size
+static thread_local std::vector<std::pair<void *, size_t>> rtbuffer_list;
+
+void *rtbuffer_alloc(size_t bytes) {
+    const bool huge = bytes >= RTBUFFER_HUGE_PAGE;
+    const size_t align = huge ? RTBUFFER_HUGE_PAGE : RTBUFFER_CACHE_LINE;
+
+    void *ptr = nullptr;
+    if (int err = posix_memalign(&ptr, align, std::max<size_t>(bytes, 1))) {
+        fprintf(stderr, "ERROR: Could not allocate %zu bytes: %s\n", bytes,
+                strerror(err));
+        return nullptr;
+    }
+
+    // Best effort, transparent huge pages may be disabled
+    if (huge) {
+        madvise(ptr, bytes, MADV_HUGEPAGE);
+    }
+
+    // First touch from the calling (pinned) thread decides the NUMA node
+    memset(ptr, 0, bytes);
+
+    rtbuffer_list.emplace_back(ptr, bytes);
+    return ptr;
+}
+
+void rtbuffer_free(void *ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+
+    auto it = std::find_if(rtbuffer_list.begin(), rtbuffer_list.end(),
+                           [ptr](const auto &buf) { return buf.first == ptr; });
+    if (it != rtbuffer_list.end()) {
+        rtbuffer_list.erase(it);
+    }
+    free(ptr);
+}
+
+void rtbuffer_report(const char *who) {
+    if (rtbuffer_list.empty()) {
+        return;
+    }
+
+    unsigned cpu = 0, node = 0;
+    syscall(SYS_getcpu, &cpu, &node, nullptr);
+
+    // With a NULL nodes array, move_pages only queries where pages are
+    const size_t page_size = sysconf(_SC_PAGESIZE);
+    std::vector<void *> pages;
+    for (const auto &[ptr, bytes] : rtbuffer_list) {
+        for (size_t off = 0; off < bytes; off += page_size) {
+            pages.push_back((char *)ptr + off);
+        }
+    }
+
+    std::vector<int> status(pages.size());
+    if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr,
+                status.data(), 0)) {
+        printf("[%s] cpu %u, node %u: %zu buffers, %zu pages, placement "
+               "unknown (%s)\n",
+               who, cpu, node, rtbuffer_list.size(), pages.size(),
+               strerror(errno));
+        return;
+    }
+
+    // Negative values are errors (e.g., -ENOENT for pages not present)
+    std::map<int, size_t> per_node;
+    for (int s : status) {
+        per_node[s < 0 ? -1 : s]++;
+    }
+
+    printf("[%s] cpu %u, node %u: %zu buffers, %zu pages:", who, cpu, node,
+           rtbuffer_list.size(), pages.size());
+    for (const auto &[n, count] : per_node) {
+        if (n < 0) {
+            printf(" unmapped %zu", count);
+        } else {
+            printf(" node%d %zu%s", n, count, unsigned(n) == node ? "" : " (!)");
+        }
+    }
+    printf("\n");
+}
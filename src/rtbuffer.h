@@ -0,0 +1,35 @@
+#ifndef RTBUFFER_H
+#define RTBUFFER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          Workload Kernel Buffers                          ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+//
+// Allocator for the data of workload kernels. Tasks initialize their kernel
+// after being pinned, so buffers are allocated and first-touched on the CPU
+// (and thus on the NUMA node) of the task. Buffers are aligned to cache lines,
+// or to (transparent) huge pages when large enough, and are tracked per
+// thread, so that their placement can be reported.
+
+// Allocates a zeroed buffer of the given size, returns NULL on error.
+extern void *rtbuffer_alloc(size_t bytes);
+
+// Releases a buffer returned by rtbuffer_alloc() (NULL is ignored). Must be
+// called by the same thread that allocated it.
+extern void rtbuffer_free(void *ptr);
+
+// Prints on which NUMA nodes the pages of the buffers currently allocated by
+// the calling thread reside, compared to the node of the calling CPU.
+extern void rtbuffer_report(const char *who);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RTBUFFER_H
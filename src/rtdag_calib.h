@@ -1,11 +1,21 @@
 #ifndef RTDAG_CALIB_H
 #define RTDAG_CALIB_H
 
+#include "newstuff/schedutils.h"
 #include "time_aux.h"
 
+#include <sched.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <cmath>
 #include <iostream>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <vector>
 using namespace std;
 
 // ╔═══════════════════════════════════════════════════════════════════════════╗
@@ -21,7 +31,7 @@ using namespace std;
     } while (0)
 #endif
 
-int get_ticks_per_us(bool required) {
+inline int get_ticks_per_us(bool required) {
     if (ticks_per_us > 0) {
         return EXIT_SUCCESS;
     }
@@ -50,7 +60,7 @@ int get_ticks_per_us(bool required) {
     return EXIT_SUCCESS;
 }
 
-int waste_calibrate() {
+inline int waste_calibrate() {
     COMPILER_BARRIER();
 
     uint64_t retv = Count_Time_Ticks(1, 1);
@@ -60,11 +70,9 @@ int waste_calibrate() {
     return retv;
 }
 
-int test_calibration(uint64_t duration_us, uint64_t &time_difference) {
-    int res = get_ticks_per_us(true);
-    if (res)
-        return res;
-
+// Runs the selected kernel for duration_us according to the given
+// ticks_per_us, returns how long it actually took (in us)
+inline uint64_t measure_ticks(uint64_t duration_us, float ticks_per_us) {
     COMPILER_BARRIER();
 
     auto time_before = micros();
@@ -80,20 +88,174 @@ int test_calibration(uint64_t duration_us, uint64_t &time_difference) {
 
     COMPILER_BARRIER();
 
-    time_difference = time_after - time_before;
+    return time_after - time_before;
+}
+
+inline int test_calibration(uint64_t duration_us,
+                            uint64_t &time_difference) {
+    int res = get_ticks_per_us(true);
+    if (res)
+        return res;
+
+    time_difference = measure_ticks(duration_us, ticks_per_us);
     cout << "Test duration: " << time_difference << " micros" << endl;
 
     return 0;
 }
 
-int test_calibration(uint64_t duration_us) {
+inline int test_calibration(uint64_t duration_us) {
     uint64_t time_difference_unused;
     return test_calibration(duration_us, time_difference_unused);
 }
 
-int calibrate(uint64_t duration_us) {
+// How calibrate_converge() estimates ticks_per_us
+struct calibration_params {
+    // Stop when two consecutive estimates differ (relatively) by less than
+    // tolerance, or after max_iter iterations
+    double tolerance = 0;
+    int max_iter = 1;
+
+    // Number of measurements taken in each iteration
+    int samples = 1;
+
+    // Which measured duration defines ticks_per_us: a percentile in [0, 100]
+    // (e.g., 50 for the median), or a negative value for the mean. Lower
+    // percentiles (faster runs) give larger, more conservative, values.
+    double statistic = 50;
+};
+
+// Parses min, median, mean, max or pNN (e.g., p10) into a statistic
+inline optional<double> parse_calibration_statistic(const string &str) {
+    if (str == "min") {
+        return 0;
+    } else if (str == "median") {
+        return 50;
+    } else if (str == "mean") {
+        return -1;
+    } else if (str == "max") {
+        return 100;
+    } else if (str.size() > 1 && str[0] == 'p') {
+        auto mstream = std::istringstream(str.substr(1));
+        double percentile;
+        if (mstream >> percentile && mstream.eof() && percentile >= 0 &&
+            percentile <= 100) {
+            return percentile;
+        }
+    }
+    return nullopt;
+}
+
+// Summary of the durations measured in one calibration iteration, in us
+struct calibration_stats {
+    double min, median, p99, max, mean, cov, selected;
+};
+
+// Linear interpolation between the closest ranks, sorted must not be empty
+inline double calibration_percentile(const vector<uint64_t> &sorted,
+                                     double percentile) {
+    const double rank = percentile / 100 * (sorted.size() - 1);
+    const size_t lo = size_t(rank);
+    const size_t hi = std::min(lo + 1, sorted.size() - 1);
+    return sorted[lo] + (rank - lo) * (double(sorted[hi]) - sorted[lo]);
+}
+
+inline calibration_stats calibration_summary(vector<uint64_t> durations,
+                                             double statistic) {
+    std::sort(durations.begin(), durations.end());
+
+    double sum = 0, sum_sq = 0;
+    for (uint64_t d : durations) {
+        sum += d;
+        sum_sq += double(d) * d;
+    }
+    const double n = durations.size();
+    const double mean = sum / n;
+    const double var = std::max(sum_sq / n - mean * mean, 0.0);
+
+    calibration_stats stats;
+    stats.min = durations.front();
+    stats.median = calibration_percentile(durations, 50);
+    stats.p99 = calibration_percentile(durations, 99);
+    stats.max = durations.back();
+    stats.mean = mean;
+    stats.cov = std::sqrt(var) / mean;
+    stats.selected = statistic < 0
+                         ? mean
+                         : calibration_percentile(durations, statistic);
+    return stats;
+}
+
+struct calibration_result {
+    float ticks_per_us;
+    int iterations;
+    bool converged;
+
+    // Relative error of a final test run (only if max_iter > 1)
+    double residual;
+
+    // Of the last iteration
+    calibration_stats stats;
+};
+
+// Repeats the calibration starting from the initial estimate, each time using
+// the previous estimate, until the estimate converges (see
+// calibration_params). Each iteration measures params.samples durations and
+// derives the new estimate from the selected statistic. Does not touch the
+// global ticks_per_us, so it can be run concurrently by pinned threads.
+inline calibration_result calibrate_converge(uint64_t duration_us,
+                                             float initial,
+                                             const calibration_params &params,
+                                             bool verbose) {
+    using ticks_type = decltype(ticks_per_us);
+
+    calibration_result res{initial, 0, false, 0, {}};
+    vector<uint64_t> durations(params.samples);
+    while (res.iterations < params.max_iter && !res.converged) {
+        for (auto &time_difference : durations) {
+            time_difference = measure_ticks(duration_us, res.ticks_per_us);
+            // fprintf(stderr, "DEBUG: %llu %llu %llu %llu\n", duration_us,
+            // time_difference, ticks_per_us, duration_us * ticks_per_us);
+        }
+        res.stats = calibration_summary(durations, params.statistic);
+
+        const ticks_type previous = res.ticks_per_us;
+        res.ticks_per_us = ticks_type(double(duration_us * previous) /
+                                      std::max(res.stats.selected, 1.0));
+        ++res.iterations;
+
+        const double change =
+            std::abs(double(res.ticks_per_us - previous)) / res.ticks_per_us;
+        res.converged = change < params.tolerance;
+        if (verbose && params.samples == 1) {
+            cout << "Test duration: " << durations[0] << " micros" << endl;
+        } else if (verbose) {
+            cout << "Test durations (" << params.samples
+                 << " samples): min " << res.stats.min << ", median "
+                 << res.stats.median << ", p99 " << res.stats.p99 << ", max "
+                 << res.stats.max << " micros, CoV " << res.stats.cov * 100
+                 << "%" << endl;
+        }
+        if (verbose && params.max_iter > 1) {
+            cout << "Iteration " << res.iterations << ": " << res.ticks_per_us
+                 << " ticks/us (change " << change * 100 << "%)" << endl;
+        }
+    }
+
+    if (params.max_iter > 1) {
+        const uint64_t time_difference =
+            measure_ticks(duration_us, res.ticks_per_us);
+        res.residual = std::abs(double(time_difference) - double(duration_us)) /
+                       double(duration_us);
+    }
+
+    return res;
+}
+
+// Calibrates the global ticks_per_us in-process (see calibrate_converge()),
+// then reports the final value, the iterations and the residual error.
+inline int calibrate(uint64_t duration_us,
+                     const calibration_params &params = {}) {
     int ret;
-    uint64_t time_difference = 1;
 
     ret = get_ticks_per_us(false);
     if (ret) {
@@ -104,20 +266,85 @@ int calibrate(uint64_t duration_us) {
     cout << "About to calibrate for (roughly) " << duration_us << " micros ..."
          << endl;
 
-    // Will never return an error
-    test_calibration(duration_us, time_difference);
-    // fprintf(stderr, "DEBUG: %llu %llu %llu %llu\n", duration_us,
-    // time_difference, ticks_per_us, duration_us * ticks_per_us);
+    const auto res = calibrate_converge(duration_us, ticks_per_us, params, true);
+    ticks_per_us = res.ticks_per_us;
 
-    using ticks_type = decltype(ticks_per_us);
-
-    ticks_per_us = ticks_type(double(duration_us * ticks_per_us) /
-                              double(time_difference));
+    if (params.max_iter > 1) {
+        cout << "Calibration "
+             << (res.converged ? "converged" : "did NOT converge") << " after "
+             << res.iterations << " iterations, residual error "
+             << res.residual * 100 << "%" << endl;
+    }
 
     cout << "Calibration successful, use: 'export TICKS_PER_US=" << ticks_per_us
          << "'" << endl;
 
-    return EXIT_SUCCESS;
+    return (res.converged || params.max_iter == 1) ? EXIT_SUCCESS
+                                                   : EXIT_FAILURE;
+}
+
+// The conditions the calibration runs under. Tasks run pinned and with the
+// scheduling attributes of the DAG (see Task::common_pin() and
+// sched_info::set()), calibrating without them biases ticks_per_us.
+struct calibration_env {
+    // The CPU to pin to, -1 to keep the current affinity
+    int cpu = -1;
+
+    // Applied after pinning, like tasks do
+    optional<sched_info> scheduling;
+
+    // Lock all the current and future memory of the process
+    bool mlock = false;
+};
+
+// The SCHED_FIFO priority applied by env, 0 if none (see rtkernel_params)
+inline int calibration_priority(const calibration_env &env) {
+    return env.scheduling ? int(env.scheduling->priority()) : 0;
+}
+
+inline bool calibration_pin(int cpu) {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    return sched_setaffinity(0, sizeof(cpuset), &cpuset) == 0;
+}
+
+// First half of calibration_env_apply(): locks the memory and pins the
+// calling thread, exits on error. If env was already applied, the thread goes
+// back to SCHED_OTHER first: SCHED_DEADLINE threads can neither change their
+// affinity nor create threads (e.g., the team of omp_host). Like tasks do
+// (see Task::task_body()), the kernel must be initialized between this and
+// calibration_env_schedule().
+inline void calibration_env_pin(const calibration_env &env) {
+    if (env.mlock && mlockall(MCL_CURRENT | MCL_FUTURE)) {
+        fprintf(stderr, "ERROR: mlockall() failed: %s\n", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    if (env.scheduling && sched_getscheduler(0) != SCHED_OTHER) {
+        struct sched_param param = {};
+        sched_setscheduler(0, SCHED_OTHER, &param);
+    }
+
+    if (env.cpu >= 0 && !calibration_pin(env.cpu)) {
+        fprintf(stderr, "ERROR: could not pin to core %d: %s\n", env.cpu,
+                strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
+
+// Second half of calibration_env_apply(): sets the scheduling attributes
+inline void calibration_env_schedule(const calibration_env &env) {
+    if (env.scheduling) {
+        env.scheduling->set();
+    }
+}
+
+// Applies env to the calling thread, exits on error. Can be called again by
+// the same thread to move it to another CPU.
+inline void calibration_env_apply(const calibration_env &env) {
+    calibration_env_pin(env);
+    calibration_env_schedule(env);
 }
 
 #endif // RTDAG_CALIB_H
@@ -0,0 +1,149 @@
+#ifndef RTDAG_COMM_H
+#define RTDAG_COMM_H
+
+#include <chrono>
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "input.h"
+#include "multi_queue.h"
+#include "newstuff/commmodel.h"
+#include "newstuff/schedutils.h"
+#include "rtdag_calib.h"
+#include "rtdag_command.h"
+#include "timesource.h"
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                        Communication Calibration                          ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+// How long the sender sleeps before each message, so that the receiver is
+// blocked in pop() when the message arrives, as it usually is in the DAG
+#define COMM_IDLE_US 100
+
+// Sends samples messages of the given size from a thread running under the
+// sender conditions to one running under the receiver conditions, through a
+// MultiQueue like the edges of the DAG (see CommModel for what is measured).
+// The sender waits for each message to be consumed before sending the next.
+inline CommModel::entry comm_measure(const calibration_env &sender,
+                                     const calibration_env &receiver,
+                                     int bytes, int samples) {
+    MultiQueue queue(1);
+    MultiQueue ack(1);
+    std::vector<char> msg(bytes, '.');
+
+    // Written by the sender before each push, read by the receiver after the
+    // corresponding pop (both under the lock of the queue)
+    uint64_t pushed_at = 0;
+
+    std::vector<uint64_t> push(samples), handoff(samples), copy(samples);
+
+    std::thread receiver_thread([&] {
+        calibration_env_apply(receiver);
+
+        std::vector<char> local(bytes);
+        for (int i = 0; i < samples; ++i) {
+            queue.pop(nullptr, 1);
+            const uint64_t received_at = timesource_now_ns();
+            handoff[i] = received_at - pushed_at;
+
+            std::memcpy(local.data(), msg.data(), bytes);
+            // Do not let the copy be optimized away
+            asm volatile("" : : "r"(local.data()) : "memory");
+            copy[i] = timesource_now_ns() - received_at;
+
+            ack.push(0, nullptr);
+        }
+    });
+
+    std::thread sender_thread([&] {
+        calibration_env_apply(sender);
+
+        for (int i = 0; i < samples; ++i) {
+            std::this_thread::sleep_for(std::chrono::microseconds(COMM_IDLE_US));
+
+            const uint64_t begin = timesource_now_ns();
+            std::memset(msg.data(), 'a' + i % 26, bytes - 1);
+            pushed_at = timesource_now_ns();
+            queue.push(0, msg.data());
+            push[i] = timesource_now_ns() - begin;
+
+            ack.pop(nullptr, 1);
+        }
+    });
+
+    sender_thread.join();
+    receiver_thread.join();
+
+    std::sort(push.begin(), push.end());
+    std::sort(handoff.begin(), handoff.end());
+    std::sort(copy.begin(), copy.end());
+    return {
+        .push_ns = calibration_percentile(push, 50),
+        .handoff_ns = calibration_percentile(handoff, 50),
+        .handoff_p99_ns = calibration_percentile(handoff, 99),
+        .copy_ns = calibration_percentile(copy, 50),
+    };
+}
+
+// Measures the communication costs of each edge of the DAG in the input file,
+// with the tasks at both ends pinned and scheduled as they are when running
+// the DAG, then updates the communication cost model. Edges with the same
+// CPUs and message size are measured once.
+inline int calibrate_comm(const opts &options) {
+    // The model may not exist yet, nor be applied to what it measures
+    input_type input(options.in_fname.c_str(), false);
+
+    CommModel model;
+    model.load(options.comm_model, false);
+
+    const auto task_env = [&](int t) {
+        calibration_env env = options.calib_env;
+        env.cpu = input.get_tasks_affinity(t);
+        env.scheduling.emplace(
+            input.get_tasks_prio(t),
+            std::chrono::microseconds(input.get_tasks_runtime(t)),
+            std::chrono::microseconds(input.get_tasks_rel_deadline(t)),
+            std::chrono::microseconds(input.get_period()));
+        return env;
+    };
+
+    cout << "About to measure " << options.comm_samples
+         << " messages on each edge ..." << endl;
+
+    std::set<CommModel::key> measured;
+    const int ntasks = input.get_n_tasks();
+    for (int from = 0; from < ntasks; ++from) {
+        for (int to = 0; to < ntasks; ++to) {
+            const int bytes = input.get_adjacency_matrix(from, to);
+            if (bytes < 1) {
+                continue;
+            }
+
+            const CommModel::key k{input.get_tasks_affinity(from),
+                                   input.get_tasks_affinity(to), bytes};
+            if (measured.insert(k).second) {
+                model.set(k, comm_measure(task_env(from), task_env(to), bytes,
+                                          options.comm_samples));
+            }
+
+            const auto e = *model.lookup(k);
+            cout << input.get_tasks_name(from) << " -> "
+                 << input.get_tasks_name(to) << " (cpu " << k.from_cpu
+                 << " -> " << k.to_cpu << ", " << bytes << " bytes): push "
+                 << e.push_ns << " ns, hand-off " << e.handoff_ns
+                 << " ns (p99 " << e.handoff_p99_ns << " ns), copy "
+                 << e.copy_ns << " ns (" << e.copy_ns / bytes << " ns/byte)"
+                 << endl;
+        }
+    }
+
+    model.save(options.comm_model);
+    cout << "Communication cost model written to " << options.comm_model
+         << endl;
+    return EXIT_SUCCESS;
+}
+
+#endif // RTDAG_COMM_H
@@ -7,21 +7,21 @@
 #include <cassert>
 #include <optional>
 
-#include "rtgauss.h"
+#include "rtdag_calib.h"
+#include "rtkernel.h"
 
-#define TASK_TYPES_CPU "cpu "
 #if RTDAG_OMP_SUPPORT == ON
-#define TASK_TYPES_OMP "omp "
 #define HELP_OMP_TARGET                                                        \
     "-T OMP_TARGET[=0]           The OpenMP target to run the task in (if "    \
-    "'omp' selected)"
+    "'omp' selected)\n"                                                        \
+    "    -O CPU[,CPU...]             The CPUs of the OpenMP thread team (if "  \
+    "'omp_host'\n"                                                             \
+    "                                selected), the first one is the "         \
+    "calling thread"
 #else
-#define TASK_TYPES_OMP ""
 #define HELP_OMP_TARGET ""
 #endif
 
-#define SUPPORTED_TASK_TYPES TASK_TYPES_CPU TASK_TYPES_OMP
-
 // ╔═══════════════════════════════════════════════════════════════════════════╗
 // ║                          Command Line Arguments                           ║
 // ╚═══════════════════════════════════════════════════════════════════════════╝
@@ -34,16 +34,66 @@ Where OPTION can be (only) one of the following:
     -h, --help                  Display this helpful message
     -c USEC, --calibrate USEC   Run a calibration diagnostic for count_ticks
     -t USEC, --test USEC        Test calibration accuracy for count_ticks
-
-The following options are used in combination with -c or -t, ignored otherwise:
-    -C TASK_TYPE[=cpu]          Accepts a task type that supports
-                                calibration to do the test
-    -M MATRIX_SIZE[=4]          The size of the matrix used in calibration
-                                tests
+    -s USEC, --sweep USEC       Calibrate count_ticks on each combination of
+                                CPU, frequency and matrix size, storing the
+                                results in a calibration database
+    -x FILE, --comm FILE        Measure the communication costs of the edges
+                                of the DAG in the input file, storing them
+                                in a communication cost model
+
+The following options can be used in any mode (and repeated):
+    -K PLUGIN, --kernel PLUGIN  Load the workload kernels exported by the
+                                given shared object (see rtkernel.h)
+
+The following options are used in combination with -c, -t or -s, ignored
+otherwise:
+    -C TASK_TYPE[=cpu]          Accepts a task type (i.e., a registered
+                                workload kernel) to do the test
+    -M MATRIX_SIZE[,...][=4]    The size of the matrix used in calibration
+                                tests (all the listed ones with -s, only the
+                                first one otherwise)
+    -e TOLERANCE[=0.01]         Calibration stops when two consecutive
+                                estimates differ by less than TOLERANCE
+                                (relative)
+    -I MAX_ITER[=20]            Maximum number of calibration iterations (1
+                                for a single, non-converging, estimate)
+    -n SAMPLES[=1]              Number of durations measured in each
+                                calibration iteration
+    -S STATISTIC[=median]       Which of the measured durations defines the
+                                calibration: min, median, mean, max or pNN
+                                (e.g., p10); lower ones are more conservative
+    -r PRIORITY                 Calibrate under SCHED_FIFO with the given
+                                priority, like tasks with a priority
+    -d DEADLINE                 Calibrate under SCHED_DEADLINE with the given
+                                deadline (in us), like tasks without a
+                                priority (ignored if -r is also given)
+    -m                          Lock all the memory of rtdag (mlockall)
     %s
 
+The following options are used in combination with -c or -t, ignored
+otherwise:
+    -a CPU                      Pin the calibration to the given CPU
+
+The following options are used in combination with -x, ignored otherwise:
+    -n SAMPLES[=1000]           Number of messages sent on each edge
+    -m                          Lock all the memory of rtdag (mlockall)
+
+The following options are used in combination with -s, ignored otherwise:
+    -D FILE                     The calibration database to update (see
+                                newstuff/calibdb.h), required
+    -P CPU[,CPU...]             The CPUs to calibrate on (default all the
+                                CPUs available to rtdag)
+    -F MHZ[,MHZ...]             The frequencies to calibrate at, set through
+                                cpufreq (default the current ones, stored as
+                                0 in the database)
+    -p                          Calibrate all the CPUs concurrently, once
+                                with the others idle and once with all of
+                                them busy, also storing the slowdown factor
+
 
-Accepted task types: %s
+Accepted task types: )STRING";
+
+    auto usage_format_end = R"STRING(
 
 So if you want for example to calibrate a 'cpu' task multiplying two 10x10
 matrices you can do it by passing -c USEC -C cpu -M 10
@@ -55,12 +105,13 @@ information is: %s.
 
     if constexpr (input_type::has_input_file) {
         printf(usage_format, program_name,
-               "| <INPUT_" INPUT_TYPE_NAME_CAPS "_FILE> ", HELP_OMP_TARGET,
-               SUPPORTED_TASK_TYPES, INPUT_TYPE_NAME);
+               "| <INPUT_" INPUT_TYPE_NAME_CAPS "_FILE> ", HELP_OMP_TARGET);
     } else {
-        printf(usage_format, program_name, "", HELP_OMP_TARGET,
-               SUPPORTED_TASK_TYPES, INPUT_TYPE_NAME);
+        printf(usage_format, program_name, "", HELP_OMP_TARGET);
     }
+
+    rtkernel_print_names();
+    printf(usage_format_end, INPUT_TYPE_NAME);
 }
 
 enum class command_action {
@@ -68,15 +119,28 @@ enum class command_action {
     RUN_DAG,
     CALIBRATE,
     TEST,
+    SWEEP,
+    COMM,
 };
 
 struct opts {
     command_action action = command_action::RUN_DAG;
     string in_fname = "";
     uint64_t duration_us = 0;
-    rtgauss_type rtg_type = RTGAUSS_CPU;
+    const rtkernel *kernel = nullptr;
+    string kernel_name = "cpu";
     int rtg_target = 0;
+    vector<int> rtg_cpus;
     int rtg_msize = 4;
+    vector<int> rtg_msizes = {4};
+    calibration_params calib = {.tolerance = 0.01, .max_iter = 20};
+    string calib_db = "";
+    vector<int> sweep_cpus;
+    vector<int> sweep_freqs;
+    bool sweep_parallel = false;
+    calibration_env calib_env;
+    string comm_model = "";
+    int comm_samples = 1000;
     int exit_code = EXIT_SUCCESS;
 };
 
@@ -91,37 +155,44 @@ optional<ReturnType> parse_argument_from_string(const char *str) {
     return mstream ? optional<ReturnType>(rt) : nullopt;
 }
 
-template <>
-optional<rtgauss_type> parse_argument_from_string(const char *str) {
+// Parses a comma-separated list of values
+template <class ValueType>
+optional<vector<ValueType>> parse_list_from_string(const char *str) {
     auto mstring = std::string(str);
+    auto mstream = std::istringstream(mstring);
 
-    if (mstring == "cpu") {
-        return optional<rtgauss_type>(RTGAUSS_CPU);
-    }
-#if RTDAG_OMP_SUPPORT == ON
-    if (mstring == "omp") {
-        return optional<rtgauss_type>(RTGAUSS_OMP);
+    vector<ValueType> values;
+    for (std::string item; std::getline(mstream, item, ',');) {
+        auto value = parse_argument_from_string<ValueType>(item.c_str());
+        if (!value) {
+            return nullopt;
+        }
+        values.push_back(*value);
     }
-#endif
 
-    return nullopt;
+    return values.empty() ? nullopt : optional<vector<ValueType>>(values);
 }
 
 opts parse_args(int argc, char *argv[]) {
     opts program_options;
     char the_option = ' ';
+    u32 calib_priority = 0;
+    u64 calib_deadline_us = 0;
     while (true) {
         int option_index = 0;
         static struct option long_options[] = {
             {"help", no_argument, 0, 'h'},
             {"calibrate", required_argument, 0, 'c'},
             {"test", required_argument, 0, 't'},
+            {"sweep", required_argument, 0, 's'},
+            {"comm", required_argument, 0, 'x'},
+            {"kernel", required_argument, 0, 'K'},
             {0, 0, 0, 0}};
 
         int c = getopt_long(argc, argv,
-                            "hc:t:C:M:"
+                            "hc:t:s:x:C:K:M:e:I:n:S:D:P:F:pa:r:d:m"
 #if RTDAG_OMP_SUPPORT == ON
-                            "T:"
+                            "T:O:"
 #endif
                             ,
                             long_options, &option_index);
@@ -143,37 +214,135 @@ opts parse_args(int argc, char *argv[]) {
             program_options.action = command_action::HELP;
             goto end;
         case 'c':
-        case 't': {
+        case 't':
+        case 's': {
             auto duration_valid = parse_argument_from_string<uint64_t>(optarg);
             if (!duration_valid) {
                 goto arg_error;
             }
             program_options.duration_us = *duration_valid;
-            program_options.action =
-                c == 'c' ? command_action::CALIBRATE : command_action::TEST;
+            program_options.action = c == 'c'   ? command_action::CALIBRATE
+                                     : c == 't' ? command_action::TEST
+                                                : command_action::SWEEP;
+            break;
+        }
+        case 'x':
+            program_options.comm_model = optarg;
+            program_options.action = command_action::COMM;
+            break;
+        case 'C':
+            // Resolved after all the plugins have been loaded
+            program_options.kernel_name = optarg;
+            break;
+        case 'K':
+            if (rtkernel_load_plugin(optarg) < 0) {
+                goto arg_error;
+            }
+            break;
+        case 'M': {
+            auto msizes = parse_list_from_string<int>(optarg);
+            if (!msizes) {
+                goto arg_error;
+            }
+
+            for (int msize : *msizes) {
+                if (msize <= 0) {
+                    goto arg_error;
+                }
+            }
+            program_options.rtg_msizes = *msizes;
+            program_options.rtg_msize = msizes->front();
+            break;
+        }
+        case 'D':
+            program_options.calib_db = optarg;
+            break;
+        case 'p':
+            program_options.sweep_parallel = true;
+            break;
+        case 'P':
+        case 'F': {
+            auto values = parse_list_from_string<int>(optarg);
+            if (!values) {
+                goto arg_error;
+            }
+
+            for (int value : *values) {
+                if (value < 0) {
+                    goto arg_error;
+                }
+            }
+            (c == 'P' ? program_options.sweep_cpus
+                      : program_options.sweep_freqs) = *values;
             break;
         }
-        case 'C': {
-            auto type_valid = parse_argument_from_string<rtgauss_type>(optarg);
-            if (!type_valid) {
+        case 'e': {
+            auto tolerance = parse_argument_from_string<double>(optarg);
+            if (!tolerance || *tolerance < 0) {
                 goto arg_error;
             }
 
-            program_options.rtg_type = *type_valid;
+            program_options.calib.tolerance = *tolerance;
             break;
         }
-        case 'M': {
-            auto msize = parse_argument_from_string<int>(optarg);
-            if (!msize) {
+        case 'I': {
+            auto max_iter = parse_argument_from_string<int>(optarg);
+            if (!max_iter || *max_iter < 1) {
+                goto arg_error;
+            }
+
+            program_options.calib.max_iter = *max_iter;
+            break;
+        }
+        case 'n': {
+            auto samples = parse_argument_from_string<int>(optarg);
+            if (!samples || *samples < 1) {
+                goto arg_error;
+            }
+
+            program_options.calib.samples = *samples;
+            program_options.comm_samples = *samples;
+            break;
+        }
+        case 'S': {
+            auto statistic = parse_calibration_statistic(optarg);
+            if (!statistic) {
+                goto arg_error;
+            }
+
+            program_options.calib.statistic = *statistic;
+            break;
+        }
+        case 'a': {
+            auto cpu = parse_argument_from_string<int>(optarg);
+            if (!cpu || *cpu < 0 || *cpu >= CPU_SETSIZE) {
                 goto arg_error;
             }
 
-            program_options.rtg_msize = *msize;
-            if (program_options.rtg_msize <= 0) {
+            program_options.calib_env.cpu = *cpu;
+            break;
+        }
+        case 'r': {
+            auto priority = parse_argument_from_string<u32>(optarg);
+            if (!priority || *priority < 1 || *priority > 99) {
+                goto arg_error;
+            }
+
+            calib_priority = *priority;
+            break;
+        }
+        case 'd': {
+            auto deadline = parse_argument_from_string<u64>(optarg);
+            if (!deadline || *deadline == 0) {
                 goto arg_error;
             }
+
+            calib_deadline_us = *deadline;
             break;
         }
+        case 'm':
+            program_options.calib_env.mlock = true;
+            break;
         case 'T': {
             auto target = parse_argument_from_string<int>(optarg);
             if (!target) {
@@ -186,6 +355,15 @@ opts parse_args(int argc, char *argv[]) {
             }
             break;
         }
+        case 'O': {
+            auto cpus = parse_list_from_string<int>(optarg);
+            if (!cpus) {
+                goto arg_error;
+            }
+
+            program_options.rtg_cpus = *cpus;
+            break;
+        }
         case '?':
             // fprintf(stderr, "Error: ?? getopt returned character code
             // 0%o ??\n", c);
@@ -200,7 +378,32 @@ opts parse_args(int argc, char *argv[]) {
         }
     }
 
-    if (program_options.action != command_action::RUN_DAG) {
+    if (calib_priority > 0 || calib_deadline_us > 0) {
+        // Same as the tasks, the priority wins over the deadline
+        const sched_info::ns deadline =
+            std::chrono::microseconds(calib_deadline_us);
+        program_options.calib_env.scheduling.emplace(calib_priority, deadline,
+                                                     deadline, deadline);
+    }
+
+    if (program_options.action == command_action::SWEEP &&
+        program_options.calib_db.empty()) {
+        fprintf(stderr, "Error: missing calibration database (-D)!\n");
+        program_options.action = command_action::HELP;
+        program_options.exit_code = EXIT_FAILURE;
+        goto end;
+    }
+
+    if (program_options.action != command_action::RUN_DAG &&
+        program_options.action != command_action::COMM) {
+        program_options.kernel =
+            rtkernel_find(program_options.kernel_name.c_str());
+        if (program_options.kernel == nullptr) {
+            fprintf(stderr, "Unsupported task type: %s\n",
+                    program_options.kernel_name.c_str());
+            program_options.action = command_action::HELP;
+            program_options.exit_code = EXIT_FAILURE;
+        }
         goto end;
     }
 
@@ -1,12 +1,18 @@
 #include <cstdlib>
 
 #include "rtdag_calib.h"
+#include "rtdag_comm.h"
 #include "rtdag_command.h"
 #include "rtdag_run.h"
+#include "rtdag_sweep.h"
 
-#include "rtgauss.h"
+#include "rtkernel.h"
+#include "timesource.h"
 
 int main(int argc, char *argv[]) {
+    // Keep the calibration of the time source out of any measurement
+    timesource_init();
+
     auto program_options = parse_args(argc, argv);
 
     switch (program_options.action) {
@@ -15,24 +21,48 @@ int main(int argc, char *argv[]) {
         return program_options.exit_code;
 
     case command_action::CALIBRATE: {
+        calibration_env_pin(program_options.calib_env);
+
         // FIXME: pre-charge code on the GPU
-        rtgauss_init(program_options.rtg_msize, program_options.rtg_type,
-                     program_options.rtg_target);
+        rtkernel_params params{
+            program_options.rtg_msize, program_options.rtg_target,
+            program_options.rtg_cpus.data(),
+            int(program_options.rtg_cpus.size()),
+            calibration_priority(program_options.calib_env)};
+        if (rtkernel_init(program_options.kernel, &params)) {
+            return EXIT_FAILURE;
+        }
         ofstream nullf("/dev/null");
         auto retv = waste_calibrate();
         nullf << retv;
-        return calibrate(program_options.duration_us);
+        calibration_env_schedule(program_options.calib_env);
+        return calibrate(program_options.duration_us, program_options.calib);
     }
 
     case command_action::TEST: {
-        rtgauss_init(program_options.rtg_msize, program_options.rtg_type,
-                     program_options.rtg_target);
+        calibration_env_pin(program_options.calib_env);
+
+        rtkernel_params params{
+            program_options.rtg_msize, program_options.rtg_target,
+            program_options.rtg_cpus.data(),
+            int(program_options.rtg_cpus.size()),
+            calibration_priority(program_options.calib_env)};
+        if (rtkernel_init(program_options.kernel, &params)) {
+            return EXIT_FAILURE;
+        }
         ofstream nullf("/dev/null");
         auto retv = waste_calibrate();
         nullf << retv;
+        calibration_env_schedule(program_options.calib_env);
         return test_calibration(program_options.duration_us);
     }
 
+    case command_action::SWEEP:
+        return calibrate_sweep(program_options);
+
+    case command_action::COMM:
+        return calibrate_comm(program_options);
+
     case command_action::RUN_DAG:
         if (program_options.exit_code != EXIT_SUCCESS) {
             return program_options.exit_code;
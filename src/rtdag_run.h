@@ -1,7 +1,14 @@
 #ifndef RTDAG_RUN_H
 #define RTDAG_RUN_H
 
+#include <sys/stat.h>
+
+#include <fstream>
+#include <iostream>
+#include <memory>
+
 #include "input.h"
+#include "newstuff/cpufreq.h"
 #include "newstuff/taskset.h"
 
 // the dag definition is here
@@ -46,32 +53,49 @@ int run_dag(string in_fname) {
     std::unique_ptr<input_base> inputs =
         std::make_unique<input_type>(in_fname.c_str());
     dump(*inputs);
-    DagTaskset task_set(inputs);
-    std::cout << "\nPrinting the input DAG: \n";
-    task_set.print();
 
-    // Check whether the environment contains the TICKS_PER_US variable
-    int ret = get_ticks_per_us(true);
-    if (ret) {
-        return ret;
+    // The environment must contain the TICKS_PER_US variable unless every
+    // task has its own value (given explicitly or by the calibration
+    // database). Until then the global value is zero, so non-positive values
+    // are the tasks that fall back to it. This must be done before the tasks
+    // are created, since they take their value from it.
+    bool needs_global_ticks = false;
+    for (unsigned t = 0; t < inputs->get_n_tasks(); ++t) {
+        needs_global_ticks |= inputs->get_ticks_per_us(t) <= 0;
+    }
+    if (needs_global_ticks) {
+        int ret = get_ticks_per_us(true);
+        if (ret) {
+            return ret;
+        }
     }
 
+#if RTDAG_CPUFREQ == ON
+    // Restored when run_dag returns (or on exit)
+    CpufreqGuard cpufreq(inputs->get_cpus_freq());
+#endif
+
+    DagTaskset task_set(*inputs);
+    std::cout << "\nPrinting the input DAG: \n";
+    task_set.print(std::cout);
+
     // create the directory where execution time are saved
     struct stat st; // This is C++, you cannot use {0} to initialize to zero an
                     // entire struct.
     memset(&st, 0, sizeof(struct stat));
-    if (stat(task_set.get_dagset_name(), &st) == -1) {
+    if (stat(task_set.dag.name.c_str(), &st) == -1) {
         // permisions required in order to allow using rsync since rt-dag is run
         // as root in the target computer
-        int rv = mkdir(task_set.get_dagset_name(), 0777);
+        int rv = mkdir(task_set.dag.name.c_str(), 0777);
         if (rv != 0) {
             perror("ERROR creating directory");
             exit(1);
         }
     }
 
-    // pass pid_list such that tasks can be killed with CTRL+C
-    task_set.launch_tasks(&pid_list, seed);
+    task_set.start();
+    task_set.join();
+
     // "" is used only to avoid variadic macro warning
     LOG(INFO, "[main] all tasks were finished%s...\n", " ");
 
@@ -0,0 +1,211 @@
+#ifndef RTDAG_SWEEP_H
+#define RTDAG_SWEEP_H
+
+#include <sched.h>
+
+#include <atomic>
+#include <barrier>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "newstuff/calibdb.h"
+#include "newstuff/cpufreq.h"
+#include "rtdag_calib.h"
+#include "rtdag_command.h"
+#include "rtkernel.h"
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                            Calibration Sweep                              ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+
+inline std::vector<int> sweep_default_cpus() {
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    sched_getaffinity(0, sizeof(cpuset), &cpuset);
+
+    std::vector<int> cpus;
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpuset)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+// Calibrates a kernel of the given size on a new thread pinned to cpu (with
+// the scheduling attributes given on the command line), with all the other
+// threads spawned by the same call to calibrate_parallel().
+// Threads that finish early keep running the kernel until all of them are
+// done, so that the contention lasts for the whole calibration.
+inline void calibrate_parallel(const opts &options, int size,
+                               const std::vector<int> &cpus,
+                               std::vector<calibration_result> &results) {
+    const int n = cpus.size();
+    std::barrier<> start(n);
+    std::atomic<int> running = n;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < n; ++i) {
+        threads.emplace_back([&, i] {
+            calibration_env env = options.calib_env;
+            env.cpu = cpus[i];
+            calibration_env_pin(env);
+
+            rtkernel_params params{size, options.rtg_target,
+                                   options.rtg_cpus.data(),
+                                   int(options.rtg_cpus.size()),
+                                   calibration_priority(env)};
+            if (rtkernel_init(options.kernel, &params)) {
+                exit(EXIT_FAILURE);
+            }
+            waste_calibrate();
+            calibration_env_schedule(env);
+
+            start.arrive_and_wait();
+            results[i] =
+                calibrate_converge(options.duration_us, results[i].ticks_per_us,
+                                   options.calib, false);
+            running--;
+
+            for (uint64_t in = 0; running > 0;) {
+                in = rtkernel_step(in);
+            }
+            rtkernel_teardown();
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+// Calibrates all the CPUs concurrently: first each CPU alone with the others
+// idle, then all of them at the same time, to measure the slowdown caused by
+// the contention on shared caches and memory.
+inline int calibrate_sweep_parallel(const opts &options, CalibDB &db,
+                                    const std::vector<int> &cpus,
+                                    const std::vector<int> &freqs) {
+    const float initial = ticks_per_us > 0 ? ticks_per_us : 10;
+
+    int retv = EXIT_SUCCESS;
+    for (int freq : freqs) {
+        // Restored before moving to the next frequency
+        std::optional<CpufreqGuard> cpufreq;
+        if (freq > 0) {
+            std::vector<int> cpu_freqs;
+            for (int cpu : cpus) {
+                cpu_freqs.resize(std::max<size_t>(cpu_freqs.size(), cpu + 1));
+                cpu_freqs[cpu] = freq;
+            }
+            cpufreq.emplace(cpu_freqs);
+        }
+
+        for (int size : options.rtg_msizes) {
+            cout << "Sweep: " << cpus.size() << " cpus, " << freq << " MHz, "
+                 << options.kernel->name << ", size " << size << endl;
+
+            std::vector<calibration_result> isolated(cpus.size());
+            for (size_t i = 0; i < cpus.size(); ++i) {
+                std::vector<calibration_result> alone{
+                    {initial, 0, false, 0, {}}};
+                calibrate_parallel(options, size, {cpus[i]}, alone);
+                isolated[i] = alone[0];
+            }
+
+            // Start from the isolated values, to converge faster
+            std::vector<calibration_result> contended = isolated;
+            calibrate_parallel(options, size, cpus, contended);
+
+            cout << "cpu\tisolated\tcontended\tslowdown" << endl;
+            for (size_t i = 0; i < cpus.size(); ++i) {
+                const float slowdown =
+                    isolated[i].ticks_per_us / contended[i].ticks_per_us;
+                cout << cpus[i] << "\t" << isolated[i].ticks_per_us << "\t"
+                     << contended[i].ticks_per_us << "\t" << slowdown
+                     << (isolated[i].converged && contended[i].converged
+                             ? ""
+                             : "\t(did NOT converge)")
+                     << endl;
+
+                if (!isolated[i].converged || !contended[i].converged) {
+                    // Keep the value anyway, it is the best estimate we have
+                    retv = EXIT_FAILURE;
+                }
+
+                db.set({cpus[i], freq, options.kernel->name, size},
+                       {isolated[i].ticks_per_us, slowdown});
+            }
+            db.save(options.calib_db);
+        }
+    }
+
+    cout << "Calibration database written to " << options.calib_db << endl;
+    return retv;
+}
+
+// Calibrates the selected kernel on every combination of CPU, frequency and
+// matrix size, updating the calibration database after each of them (so that
+// an interrupted sweep keeps the values already computed).
+inline int calibrate_sweep(const opts &options) {
+    CalibDB db;
+    db.load(options.calib_db, false);
+
+    const auto cpus = options.sweep_cpus.empty() ? sweep_default_cpus()
+                                                 : options.sweep_cpus;
+    const auto freqs = options.sweep_freqs.empty() ? std::vector<int>{0}
+                                                   : options.sweep_freqs;
+
+    if (options.sweep_parallel) {
+        return calibrate_sweep_parallel(options, db, cpus, freqs);
+    }
+
+    int retv = EXIT_SUCCESS;
+    for (int cpu : cpus) {
+        calibration_env env = options.calib_env;
+        env.cpu = cpu;
+
+        for (int freq : freqs) {
+            // Restored before moving to the next frequency
+            std::optional<CpufreqGuard> cpufreq;
+            if (freq > 0) {
+                std::vector<int> cpu_freqs(cpu + 1, 0);
+                cpu_freqs[cpu] = freq;
+                cpufreq.emplace(cpu_freqs);
+            }
+
+            for (int size : options.rtg_msizes) {
+                cout << "Sweep: cpu " << cpu << ", " << freq << " MHz, "
+                     << options.kernel->name << ", size " << size << endl;
+
+                // Scheduled only after the kernel is initialized, each time
+                calibration_env_pin(env);
+                rtkernel_params params{size, options.rtg_target,
+                                       options.rtg_cpus.data(),
+                                       int(options.rtg_cpus.size()),
+                                       calibration_priority(env)};
+                if (rtkernel_init(options.kernel, &params)) {
+                    return EXIT_FAILURE;
+                }
+                waste_calibrate();
+                calibration_env_schedule(env);
+
+                if (calibrate(options.duration_us, options.calib) !=
+                    EXIT_SUCCESS) {
+                    // Keep the value anyway, it is the best estimate we have
+                    retv = EXIT_FAILURE;
+                }
+                rtkernel_teardown();
+
+                db.set({cpu, freq, options.kernel->name, size},
+                       {ticks_per_us});
+                db.save(options.calib_db);
+            }
+        }
+    }
+
+    cout << "Calibration database written to " << options.calib_db << endl;
+    return retv;
+}
+
+#endif // RTDAG_SWEEP_H
@@ -0,0 +1,205 @@
+// rtdag-top: displays the live counters of a running DAG (see
+// newstuff/livestats.h), refreshing them periodically.
+
+#include <fcntl.h>
+#include <getopt.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "newstuff/livestats.h"
+
+// Plain copies of the blocks, read consistently
+struct task_snapshot {
+    u64 jobs, deadline_misses, last_exec_ns, max_exec_ns, last_wait_ns,
+        max_wait_ns;
+};
+
+struct dag_snapshot {
+    u64 activations, deadline_misses, last_response_ns;
+};
+
+struct percentiles_snapshot {
+    u64 count, mean_ns, values_ns[LIVESTATS_NPERCENTILES], max_ns;
+};
+
+static inline u64 load(const std::atomic<u64> &field) {
+    return field.load(std::memory_order_relaxed);
+}
+
+static inline double us(u64 ns) {
+    return ns / 1000.;
+}
+
+static void usage(const char *program_name) {
+    std::fprintf(stderr,
+                 R"STRING(Usage: %s [ -i MSEC ] [ -1 ] DAG_NAME
+Displays the live counters of a DAG run with statistics: {live: true}.
+
+    -i MSEC     Refresh interval (default 1000)
+    -1          Print once and exit
+)STRING",
+                 program_name);
+}
+
+// The state is that of the DAG, see main()
+static void print(const livestats_segment &segment, const char *state) {
+    // Cleared by any block that cannot be read consistently
+    bool consistent = true;
+
+    dag_snapshot dag = {};
+    consistent &=
+        livestats_read(segment.dag, [&dag](const livestats_dag &block) {
+            dag = {load(block.activations), load(block.deadline_misses),
+                   load(block.last_response_ns)};
+        });
+
+    percentiles_snapshot response = {};
+    consistent &= livestats_read(
+        segment.response,
+        [&response](const livestats_percentiles_block &block) {
+            response.count = load(block.count);
+            response.mean_ns = load(block.mean_ns);
+            for (int i = 0; i < LIVESTATS_NPERCENTILES; ++i) {
+                response.values_ns[i] = load(block.values_ns[i]);
+            }
+            response.max_ns = load(block.max_ns);
+        });
+
+    std::printf("DAG %s (pid %d, %s): period %.0f us, e2e deadline %.0f us\n",
+                segment.dag_name, segment.pid, state, us(segment.period_ns),
+                us(segment.e2e_deadline_ns));
+    std::printf("activations %lu/%ld, deadline misses %lu, last response "
+                "%.1f us\n",
+                dag.activations, segment.num_activations, dag.deadline_misses,
+                us(dag.last_response_ns));
+
+    std::printf("response (%lu): mean %.1f", response.count,
+                us(response.mean_ns));
+    for (int i = 0; i < LIVESTATS_NPERCENTILES; ++i) {
+        std::printf(", p%g %.1f", livestats_percentiles[i],
+                    us(response.values_ns[i]));
+    }
+    std::printf(", max %.1f us\n\n", us(response.max_ns));
+
+    std::printf("%-16s %4s %10s %8s %12s %12s %12s %12s\n", "TASK", "CPU",
+                "JOBS", "MISSES", "EXEC_US", "MAX_EXEC_US", "WAIT_US",
+                "MAX_WAIT_US");
+    for (u32 t = 0; t < segment.ntasks && t < LIVESTATS_MAX_TASKS; ++t) {
+        const livestats_task &live = segment.tasks[t];
+
+        task_snapshot task = {};
+        consistent &=
+            livestats_read(live, [&task](const livestats_task &block) {
+                task = {load(block.jobs),         load(block.deadline_misses),
+                        load(block.last_exec_ns), load(block.max_exec_ns),
+                        load(block.last_wait_ns), load(block.max_wait_ns)};
+            });
+
+        std::printf("%-16.16s %4d %10lu %8lu %12.1f %12.1f %12.1f %12.1f\n",
+                    live.name, live.cpu, task.jobs, task.deadline_misses,
+                    us(task.last_exec_ns), us(task.max_exec_ns),
+                    us(task.last_wait_ns), us(task.max_wait_ns));
+    }
+
+    if (!consistent) {
+        std::printf("\nWARNING: some values were left in the middle of an "
+                    "update and may be wrong\n");
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long interval_ms = 1000;
+    bool once = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "hi:1")) != -1) {
+        switch (opt) {
+        case 'i':
+            interval_ms = std::atol(optarg);
+            break;
+        case '1':
+            once = true;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    if (optind != argc - 1 || interval_ms <= 0) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const std::string shm_name = livestats_shm_name(argv[optind]);
+    const int fd = shm_open(shm_name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        std::fprintf(stderr, "ERROR: could not open %s: %s\n",
+                     shm_name.c_str(), std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // Not sized yet if rtdag is still creating it
+    struct stat st;
+    if (fstat(fd, &st) || size_t(st.st_size) < sizeof(livestats_segment)) {
+        std::fprintf(stderr, "ERROR: %s is not ready yet\n", shm_name.c_str());
+        close(fd);
+        return EXIT_FAILURE;
+    }
+
+    void *addr =
+        mmap(nullptr, sizeof(livestats_segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        std::fprintf(stderr, "ERROR: could not map %s: %s\n",
+                     shm_name.c_str(), std::strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    // Once the magic is there, the rest of the header is too
+    const auto &segment = *static_cast<const livestats_segment *>(addr);
+    if (segment.magic.load(std::memory_order_acquire) != LIVESTATS_MAGIC ||
+        segment.version != LIVESTATS_VERSION ||
+        segment.size != sizeof(livestats_segment)) {
+        std::fprintf(stderr,
+                     "ERROR: %s is not a live stats segment of this version "
+                     "of rtdag\n",
+                     shm_name.c_str());
+        return EXIT_FAILURE;
+    }
+
+    for (;;) {
+        // A killed rtdag leaves running set, check that it is still there
+        bool running = segment.running.load(std::memory_order_acquire);
+        const char *state = running ? "running" : "terminated";
+        if (running && kill(segment.pid, 0) && errno == ESRCH) {
+            running = false;
+            state = "gone";
+        }
+
+        if (!once) {
+            // Clear the screen
+            std::printf("\033[H\033[2J");
+        }
+        print(segment, state);
+        std::fflush(stdout);
+
+        if (once || !running) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
+    }
+
+    munmap(addr, sizeof(livestats_segment));
+    return EXIT_SUCCESS;
+}
@@ -1,4 +1,5 @@
 #include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -11,8 +12,10 @@
 #include <omp.h>
 #endif
 
+#include <algorithm>
 #include <vector>
 
+#include "rtbuffer.h"
 #include "rtgauss.h"
 #include "time_aux.h"
 
@@ -107,6 +110,28 @@ static bool gauss_is_eye_omp_target(const double *in, const int size, int dev) {
 }
 #endif
 
+//----------------------------------------------------------
+// Fixed-size specializations
+//----------------------------------------------------------
+
+// With the size known at compile time the compiler can fully unroll and
+// vectorize the loops, so ticks are cheaper and more deterministic.
+template <int N>
+static void gauss_mul_fixed(const double *__restrict in1,
+                            const double *__restrict in2,
+                            double *__restrict out) {
+    GAUSS_MUL_BODY(in1, in2, out, N)
+}
+
+template <int N>
+static bool gauss_is_eye_fixed(const double *in) {
+    bool valid = true;
+
+    GAUSS_IS_IDENTITY_BODY(in, N, valid)
+
+    return valid;
+}
+
 //----------------------------------------------------------
 // Fill matrix
 //----------------------------------------------------------
@@ -123,36 +148,63 @@ static void gauss_fill_eye_matrix(double *out, const int size) {
 // RTGAUSS WASTE TIME
 //----------------------------------------------------------
 
+// A size x size matrix allocated by (and local to) the calling thread
+struct rtgauss_matrix {
+    double *const ptr;
+
+    explicit rtgauss_matrix(const int size) :
+        ptr((double *)rtbuffer_alloc(size * size * sizeof(double))) {
+        if (ptr == nullptr) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    rtgauss_matrix(const rtgauss_matrix &) = delete;
+    rtgauss_matrix &operator=(const rtgauss_matrix &) = delete;
+
+    ~rtgauss_matrix() {
+        rtbuffer_free(ptr);
+    }
+
+    inline double *data() const {
+        return ptr;
+    }
+};
+
 // Pack thread-allocated data together
 struct task_matrix_data {
     const int size;
     const enum rtgauss_type type;
-    std::vector<double> A;
-    std::vector<double> B;
-    std::vector<double> C;
+    rtgauss_matrix A;
+    rtgauss_matrix B;
+    rtgauss_matrix C;
+
+#if RTDAG_OMP_SUPPORT == ON
+    // Host-parallel (omp_host) team and fork/join accounting, in seconds
+    std::vector<int> team_cpus;
+    int team_priority = 0;
+    std::vector<double> team_start;
+    std::vector<double> team_end;
+    uint64_t regions = 0;
+    double fork_sum = 0, fork_max = 0;
+    double join_sum = 0, join_max = 0;
+#endif
 
     explicit task_matrix_data(const int size, const rtgauss_type type) :
         size(size),
         type(type),
-        A(size * size),
-        B(size * size),
-        C(size * size) {}
+        A(size),
+        B(size),
+        C(size) {}
 };
 
+using rtgauss_step_fn = uint64_t (*)(uint64_t);
+
 static __thread int omp_dev = -1;
 static __thread task_matrix_data *tdata = nullptr;
 
-// Must be called by each cpu and omp thread!
-void rtgauss_init(int size, rtgauss_type type, int omp_target_dev) {
-    // Construct the data with the right size
-    tdata = new task_matrix_data(size, type);
-    omp_dev = omp_target_dev;
-
-    // TODO: fill with different matrices perhaps?
-    gauss_fill_eye_matrix(tdata->A.data(), tdata->size);
-    gauss_fill_eye_matrix(tdata->B.data(), tdata->size);
-    gauss_fill_eye_matrix(tdata->C.data(), tdata->size);
-}
+// Selected once by rtgauss_init(), depending on the type and size
+static __thread rtgauss_step_fn tstep = nullptr;
 
 static uint64_t rtgauss_waste_time_cpu(uint64_t in) {
     // Operates on thread-private data of the right size!
@@ -161,6 +213,152 @@ static uint64_t rtgauss_waste_time_cpu(uint64_t in) {
     return in + ((result) ? 2 : 1);
 }
 
+template <int N>
+static uint64_t rtgauss_waste_time_cpu_fixed(uint64_t in) {
+    // Operates on thread-private data, whose size MUST be N!
+    gauss_mul_fixed<N>(tdata->A.data(), tdata->B.data(), tdata->C.data());
+    bool result = gauss_is_eye_fixed<N>(tdata->C.data());
+    return in + ((result) ? 2 : 1);
+}
+
+#if RTDAG_OMP_SUPPORT == ON
+static uint64_t rtgauss_waste_time_omp_host(uint64_t in) {
+    // NOTE: tdata is thread-local, team threads must not access it!
+    const double *A = tdata->A.data();
+    const double *B = tdata->B.data();
+    double *C = tdata->C.data();
+    double *start = tdata->team_start.data();
+    double *end = tdata->team_end.data();
+    const int size = tdata->size;
+    const int nthreads = tdata->team_cpus.size();
+    bool valid = true;
+
+    const double fork = omp_get_wtime();
+
+#pragma omp parallel num_threads(nthreads)
+    {
+        const int tid = omp_get_thread_num();
+        start[tid] = omp_get_wtime();
+
+        // Implicit barrier at the end, C must be complete before the check
+#pragma omp for collapse(2)
+        GAUSS_MUL_BODY(A, B, C, size)
+
+#pragma omp for collapse(2) reduction(&& : valid) nowait
+        GAUSS_IS_IDENTITY_BODY(C, size, valid)
+
+        end[tid] = omp_get_wtime();
+    }
+
+    const double join = omp_get_wtime();
+
+    // Fork: until the last thread of the team starts working; join: from
+    // the last thread finishing its work until the master is back.
+    double last_start = fork;
+    double last_end = fork;
+    for (int i = 0; i < nthreads; ++i) {
+        last_start = std::max(last_start, start[i]);
+        last_end = std::max(last_end, end[i]);
+    }
+
+    tdata->regions++;
+    tdata->fork_sum += last_start - fork;
+    tdata->fork_max = std::max(tdata->fork_max, last_start - fork);
+    tdata->join_sum += join - last_end;
+    tdata->join_max = std::max(tdata->join_max, join - last_end);
+
+    return in + ((valid) ? 2 : 1);
+}
+
+// Creates the team of the calling thread, pinning each member to its CPU and
+// giving it the SCHED_FIFO priority of the task, if any. The first CPU stands
+// for the calling thread itself, which is left alone: it is pinned and
+// scheduled by the caller (see tasks_affinity). OpenMP keeps the team threads
+// alive and reuses them for each parallel region started by the same thread
+// with the same number of threads.
+static void rtgauss_init_team(const int *cpus, int ncpus, int priority) {
+    if (ncpus > 0) {
+        tdata->team_cpus.assign(cpus, cpus + ncpus);
+    } else {
+        tdata->team_cpus.assign(omp_get_max_threads(), -1);
+    }
+
+    const int nthreads = tdata->team_cpus.size();
+    tdata->team_priority = priority;
+    tdata->team_start.resize(nthreads);
+    tdata->team_end.resize(nthreads);
+
+    // NOTE: tdata is thread-local, team threads must not access it!
+    const int *team_cpus = tdata->team_cpus.data();
+    int failures = 0;
+
+#pragma omp parallel num_threads(nthreads) reduction(+ : failures)
+    {
+        const int tid = omp_get_thread_num();
+        const int cpu = team_cpus[tid];
+
+        if (tid > 0 && cpu >= 0) {
+            cpu_set_t cpuset;
+            CPU_ZERO(&cpuset);
+            CPU_SET(cpu, &cpuset);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(cpuset),
+                                       &cpuset)) {
+                failures++;
+            }
+        }
+
+        if (tid > 0 && priority > 0) {
+            struct sched_param param = {};
+            param.sched_priority = priority;
+            if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) {
+                failures++;
+            }
+        }
+    }
+
+    if (failures) {
+        fprintf(stderr,
+                "ERROR: Could not pin or schedule %d OpenMP threads!\n",
+                failures);
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void rtgauss_report_team() {
+    if (tdata->regions < 1) {
+        return;
+    }
+
+    printf("omp_host: %lu parallel regions, %lu threads, fork avg %.3f us "
+           "max %.3f us, join avg %.3f us max %.3f us\n",
+           tdata->regions, tdata->team_cpus.size(),
+           SEC_TO_USEC(tdata->fork_sum / tdata->regions),
+           SEC_TO_USEC(tdata->fork_max),
+           SEC_TO_USEC(tdata->join_sum / tdata->regions),
+           SEC_TO_USEC(tdata->join_max));
+
+    // The reservation of a SCHED_DEADLINE task cannot be shared by its team
+    if (tdata->team_priority == 0 && tdata->team_cpus.size() > 1 &&
+        sched_getscheduler(0) == SCHED_DEADLINE) {
+        printf("omp_host: NOTE: the team threads of a SCHED_DEADLINE task "
+               "run as SCHED_OTHER, outside of its reservation\n");
+    }
+}
+#endif
+
+// Sizes with a specialized cpu kernel, any other size uses the generic one
+static const struct {
+    int size;
+    rtgauss_step_fn step;
+} rtgauss_cpu_fixed[] = {
+    {4, rtgauss_waste_time_cpu_fixed<4>},
+    {8, rtgauss_waste_time_cpu_fixed<8>},
+    {16, rtgauss_waste_time_cpu_fixed<16>},
+    {32, rtgauss_waste_time_cpu_fixed<32>},
+    {64, rtgauss_waste_time_cpu_fixed<64>},
+    {128, rtgauss_waste_time_cpu_fixed<128>},
+};
+
 #if RTDAG_OMP_SUPPORT == ON
 static uint64_t rtgauss_waste_time_omp(uint64_t in) {
     // Operates on thread-private data of the right size!
@@ -172,16 +370,84 @@ static uint64_t rtgauss_waste_time_omp(uint64_t in) {
 }
 #endif
 
-uint64_t rtgauss_waste_time(uint64_t in) {
-    switch (tdata->type) {
+void rtgauss_teardown(void) {
+    delete tdata;
+    tdata = nullptr;
+    tstep = nullptr;
+}
+
+static rtgauss_step_fn rtgauss_select_step(int size, rtgauss_type type) {
+    switch (type) {
     case RTGAUSS_CPU:
-        return rtgauss_waste_time_cpu(in);
+        for (const auto &fixed : rtgauss_cpu_fixed) {
+            if (fixed.size == size) {
+                return fixed.step;
+            }
+        }
+        return rtgauss_waste_time_cpu;
 #if RTDAG_OMP_SUPPORT == ON
     case RTGAUSS_OMP:
-        return rtgauss_waste_time_omp(in);
+        return rtgauss_waste_time_omp;
+    case RTGAUSS_OMP_HOST:
+        return rtgauss_waste_time_omp_host;
 #endif
     default:
-        fprintf(stderr, "ERROR: Invalid RTGAUSS type %d!\n", tdata->type);
+        fprintf(stderr, "ERROR: Invalid RTGAUSS type %d!\n", type);
         exit(EXIT_FAILURE);
     }
 }
+
+// Must be called by each cpu and omp thread, after pinning it (the matrices
+// are allocated on its NUMA node)!
+void rtgauss_init(int size, rtgauss_type type, int omp_target_dev) {
+    // Construct the data with the right size
+    tdata = new task_matrix_data(size, type);
+    omp_dev = omp_target_dev;
+    tstep = rtgauss_select_step(size, type);
+
+    // TODO: fill with different matrices perhaps?
+    gauss_fill_eye_matrix(tdata->A.data(), tdata->size);
+    gauss_fill_eye_matrix(tdata->B.data(), tdata->size);
+    gauss_fill_eye_matrix(tdata->C.data(), tdata->size);
+}
+
+uint64_t rtgauss_waste_time(uint64_t in) {
+    return tstep(in);
+}
+
+//----------------------------------------------------------
+// Kernel registry entries
+//----------------------------------------------------------
+
+static int rtgauss_kernel_init_cpu(const struct rtkernel_params *params) {
+    rtgauss_init(params->size, RTGAUSS_CPU, params->target);
+    return 0;
+}
+
+#if RTDAG_OMP_SUPPORT == ON
+static int rtgauss_kernel_init_omp(const struct rtkernel_params *params) {
+    rtgauss_init(params->size, RTGAUSS_OMP, params->target);
+    return 0;
+}
+
+static int rtgauss_kernel_init_omp_host(const struct rtkernel_params *params) {
+    rtgauss_init(params->size, RTGAUSS_OMP_HOST, params->target);
+    rtgauss_init_team(params->cpus, params->ncpus, params->priority);
+    return 0;
+}
+
+static void rtgauss_kernel_teardown_omp_host(void) {
+    rtgauss_report_team();
+    rtgauss_teardown();
+}
+#endif
+
+const struct rtkernel rtgauss_kernels[] = {
+    {"cpu", rtgauss_kernel_init_cpu, rtgauss_waste_time, rtgauss_teardown},
+#if RTDAG_OMP_SUPPORT == ON
+    {"omp", rtgauss_kernel_init_omp, rtgauss_waste_time, rtgauss_teardown},
+    {"omp_host", rtgauss_kernel_init_omp_host, rtgauss_waste_time,
+     rtgauss_kernel_teardown_omp_host},
+#endif
+    {nullptr, nullptr, nullptr, nullptr},
+};
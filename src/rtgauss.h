@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+#include "rtkernel.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -11,6 +13,7 @@ enum rtgauss_type {
     RTGAUSS_CPU = 0,
 #if RTDAG_OMP_SUPPORT == ON
     RTGAUSS_OMP = 2,
+    RTGAUSS_OMP_HOST = 3,
 #endif
 };
 
@@ -19,6 +22,14 @@ extern void rtgauss_init(int size, enum rtgauss_type type, int omp_target_dev);
 
 extern uint64_t rtgauss_waste_time(uint64_t in);
 
+// Releases the data allocated by rtgauss_init() for the calling thread.
+extern void rtgauss_teardown(void);
+
+// The rtgauss kernels ("cpu" and, if supported, "omp" and "omp_host"),
+// terminated by an element with a NULL name. Registered automatically, see
+// rtkernel.h.
+extern const struct rtkernel rtgauss_kernels[];
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,107 @@
+#include <dlfcn.h>
+#include <stdio.h>
+
+#include <map>
+#include <string>
+
+#include "rtgauss.h"
+#include "rtkernel.h"
+
+__thread const struct rtkernel *rtkernel_current = nullptr;
+
+// The registry is constructed on first use, so that kernels can be registered
+// (and looked up) at any time, including static initialization.
+static std::map<std::string, const rtkernel *> &rtkernel_registry() {
+    static std::map<std::string, const rtkernel *> registry = [] {
+        std::map<std::string, const rtkernel *> builtins;
+        for (const rtkernel *k = rtgauss_kernels; k->name != nullptr; ++k) {
+            builtins.emplace(k->name, k);
+        }
+        return builtins;
+    }();
+    return registry;
+}
+
+int rtkernel_register(const struct rtkernel *kernel) {
+    if (kernel == nullptr || kernel->name == nullptr ||
+        kernel->init == nullptr || kernel->step == nullptr) {
+        fprintf(stderr, "ERROR: Invalid kernel definition!\n");
+        return -1;
+    }
+
+    auto [it, inserted] = rtkernel_registry().emplace(kernel->name, kernel);
+    (void)it;
+    if (!inserted) {
+        fprintf(stderr, "ERROR: Kernel '%s' already registered!\n",
+                kernel->name);
+        return -1;
+    }
+
+    return 0;
+}
+
+int rtkernel_load_plugin(const char *path) {
+    // The handle is never closed: kernels must stay loaded for the entire
+    // lifetime of the process
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (handle == nullptr) {
+        fprintf(stderr, "ERROR: Could not load kernel plugin %s: %s\n", path,
+                dlerror());
+        return -1;
+    }
+
+    auto kernels =
+        (const rtkernel *)dlsym(handle, RTKERNEL_PLUGIN_SYMBOL);
+    if (kernels == nullptr) {
+        fprintf(stderr, "ERROR: Kernel plugin %s does not export '%s'!\n",
+                path, RTKERNEL_PLUGIN_SYMBOL);
+        return -1;
+    }
+
+    int count = 0;
+    for (const rtkernel *k = kernels; k->name != nullptr; ++k) {
+        if (rtkernel_register(k)) {
+            return -1;
+        }
+        count++;
+    }
+
+    return count;
+}
+
+const struct rtkernel *rtkernel_find(const char *name) {
+    const auto &registry = rtkernel_registry();
+    auto it = registry.find(name);
+    return it == registry.end() ? nullptr : it->second;
+}
+
+void rtkernel_print_names(void) {
+    for (const auto &[name, kernel] : rtkernel_registry()) {
+        (void)kernel;
+        printf("%s ", name.c_str());
+    }
+}
+
+int rtkernel_init(const struct rtkernel *kernel,
+                  const struct rtkernel_params *params) {
+    if (int res = kernel->init(params)) {
+        fprintf(stderr, "ERROR: Could not initialize kernel '%s' (%d)!\n",
+                kernel->name, res);
+        return res;
+    }
+
+    rtkernel_current = kernel;
+    return 0;
+}
+
+void rtkernel_teardown(void) {
+    if (rtkernel_current == nullptr) {
+        return;
+    }
+
+    if (rtkernel_current->teardown != nullptr) {
+        rtkernel_current->teardown();
+    }
+
+    rtkernel_current = nullptr;
+}
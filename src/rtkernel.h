@@ -0,0 +1,99 @@
+#ifndef RTKERNEL_H
+#define RTKERNEL_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ╔═══════════════════════════════════════════════════════════════════════════╗
+// ║                          Workload Kernel Registry                         ║
+// ╚═══════════════════════════════════════════════════════════════════════════╝
+//
+// A workload kernel is the unit of computation repeated by Count_Ticks() to
+// emulate the execution of a task. Kernels are looked up by the name used in
+// the YAML `tasks_type` attribute (and in the -C command line option), so
+// that any kernel automatically supports calibration, the -t test and per-job
+// timing.
+//
+// Built-in kernels (the rtgauss ones) are always registered. Additional
+// kernels can be loaded from shared objects: each plugin must export an array
+// of `struct rtkernel` named RTKERNEL_PLUGIN_SYMBOL, terminated by an element
+// whose name is NULL. Example:
+//
+//     extern "C" const struct rtkernel rtdag_kernel_plugin[] = {
+//         {"my_kernel", my_init, my_step, my_teardown},
+//         {NULL, NULL, NULL, NULL},
+//     };
+//
+// All hooks are called by the thread running the task, so kernels can (and
+// should) keep their state in thread-local storage.
+
+#define RTKERNEL_PLUGIN_SYMBOL "rtdag_kernel_plugin"
+
+// Parameters passed to the init hook, taken from the task configuration.
+struct rtkernel_params {
+    // The size of the problem (tasks_matrix_size), meaning is kernel-specific
+    int size;
+
+    // The accelerator target (tasks_omp_target), meaning is kernel-specific
+    int target;
+
+    // The CPUs of the thread team used by parallel kernels (tasks_omp_cpus),
+    // ncpus is zero if none was specified
+    const int *cpus;
+    int ncpus;
+
+    // The SCHED_FIFO priority of the task (tasks_prio), 0 if it does not run
+    // as SCHED_FIFO: threads created by the kernel should use it as well
+    int priority;
+};
+
+struct rtkernel {
+    const char *name;
+
+    // Called once by each task thread before any step. Returns 0 on success.
+    int (*init)(const struct rtkernel_params *params);
+
+    // Executes one tick of work, must return a value depending on in (to
+    // avoid the whole computation to be optimized away).
+    uint64_t (*step)(uint64_t in);
+
+    // Called once by each task thread after the last step (may be NULL).
+    void (*teardown)(void);
+};
+
+// Registers a kernel, returns 0 on success, -1 if the name is already taken.
+extern int rtkernel_register(const struct rtkernel *kernel);
+
+// Loads all the kernels exported by the given shared object. Returns the
+// number of kernels loaded, or -1 on error (error messages are printed).
+extern int rtkernel_load_plugin(const char *path);
+
+// Looks up a kernel by name, returns NULL if no such kernel is registered.
+extern const struct rtkernel *rtkernel_find(const char *name);
+
+// Prints the names of all the registered kernels, separated by spaces.
+extern void rtkernel_print_names(void);
+
+// Initializes the given kernel for the calling thread and makes it the one
+// used by rtkernel_step(). Returns 0 on success.
+extern int rtkernel_init(const struct rtkernel *kernel,
+                         const struct rtkernel_params *params);
+
+// Tears down the kernel currently selected by the calling thread.
+extern void rtkernel_teardown(void);
+
+// The kernel selected by the calling thread through rtkernel_init().
+extern __thread const struct rtkernel *rtkernel_current;
+
+static inline uint64_t rtkernel_step(uint64_t in) {
+    return rtkernel_current->step(in);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RTKERNEL_H
@@ -9,40 +9,28 @@
 #include <sched.h>
 #include <time.h>
 
-#include "rtgauss.h"
+#include "rtkernel.h"
 #include "time_aux.h"
-
-// ----------------------- Local function declarations ---------------------- //
-
-// Calculates the difference between two timespecs in useconds.
-static inline uint64_t timespec_sub_us(const struct timespec *ts1,
-                                       const struct timespec *ts2);
+#include "timesource.h"
 
 // ----------------------- Public function definitions ---------------------- //
 
 uint64_t micros(void) {
+    return NS_TO_USEC(timesource_now_ns());
+}
+
+uint64_t thread_micros(void) {
     struct timespec ts;
-    clock_gettime(CLOCK_MONOTONIC, &ts);
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
     uint64_t us =
         SEC_TO_USEC((uint64_t)ts.tv_sec) + NS_TO_USEC((uint64_t)ts.tv_nsec);
     return us;
 }
 
 uint64_t Count_Time(uint64_t duration_usec) {
-    uint64_t counted_sheeps = 0;
-    uint64_t elapsed_usecs = 0;
-    struct timespec ts1, ts2;
-
     // NOTICE that we care only of the time spent while running THIS task, not
-    // the wall time.
-    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts1);
-    do {
-        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts2);
-        elapsed_usecs = timespec_sub_us(&ts2, &ts1);
-        counted_sheeps++;
-    } while (elapsed_usecs < duration_usec);
-
-    return counted_sheeps;
+    // the wall time (see timesource.h).
+    return timesource_spin_ns(US_TO_NSEC(duration_usec));
 }
 
 // This variable must be set by the user before calling Count_Time_Ticks().
@@ -53,19 +41,27 @@ uint64_t Count_Time_Ticks(uint64_t usec, float ticks_per_us) {
     return Count_Ticks(ticks);
 }
 
+uint64_t Count_Time_Hybrid(uint64_t usec, float ticks_per_us) {
+    if (ticks_per_us <= 0) {
+        return Count_Time(usec);
+    }
+
+    const double exact = (double)ticks_per_us * usec;
+    const uint64_t ticks = exact;
+    uint64_t retv = Count_Ticks(ticks);
+
+    // The fraction of a tick that is left, in ns
+    const uint64_t rest_ns = (exact - ticks) * 1000 / ticks_per_us;
+    if (rest_ns > 0) {
+        retv += timesource_spin_ns(rest_ns);
+    }
+    return retv;
+}
+
 uint64_t Count_Ticks(uint64_t sheeps) {
     uint64_t temp = 0;
     for (uint64_t counted = 0; counted < sheeps; ++counted) {
-        temp += rtgauss_waste_time(temp);
+        temp += rtkernel_step(temp);
     }
     return temp;
 }
-
-// ------------------------ Local function definitions ---------------------- //
-
-uint64_t timespec_sub_us(const struct timespec *ts1,
-                         const struct timespec *ts2) {
-    // NOTE: assumes that ts2 >= ts1!
-    return (ts1->tv_sec - ts2->tv_sec) * 1000000 +
-           (ts1->tv_nsec - ts2->tv_nsec) / 1000;
-}
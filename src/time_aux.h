@@ -42,6 +42,10 @@ extern "C" {
 // Returns the number of microseconds wrt to wall time (CLOCK_MONOTONIC)
 extern uint64_t micros(void);
 
+// Returns the number of microseconds spent running by the calling thread
+// (CLOCK_THREAD_CPUTIME_ID)
+extern uint64_t thread_micros(void);
+
 #if defined(__GNUC__) &&                                                       \
     (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
 #define ATTRIBUTE_DISABLE_OPTIMIZATIONS __attribute__((optimize("0")))
@@ -53,8 +57,8 @@ extern uint64_t micros(void);
 #endif
 
 // Execute a fixed amount of work, depending on the number of ticks supplied.
-// The work done depends on the implementation of waste_time(), defined in the
-// source of time_aux.c.
+// The work done depends on the kernel selected by the calling thread through
+// rtkernel_init() (see rtkernel.h).
 extern uint64_t Count_Ticks(uint64_t ticks) ATTRIBUTE_DISABLE_OPTIMIZATIONS;
 
 // Execute for an amount of ticks derived from the time span indicated by
@@ -63,6 +67,14 @@ extern uint64_t Count_Ticks(uint64_t ticks) ATTRIBUTE_DISABLE_OPTIMIZATIONS;
 extern uint64_t Count_Time_Ticks(uint64_t usec, float ticks_per_us)
     ATTRIBUTE_DISABLE_OPTIMIZATIONS;
 
+// Like Count_Time_Ticks(), but runs only the whole ticks contained in usec and
+// busy-waits for the fraction of a tick left over, converted back to time
+// through ticks_per_us. With large kernels (where a tick lasts hundreds of
+// microseconds) this avoids rounding the demand to a multiple of a tick, and
+// demands shorter than a tick are still honored.
+extern uint64_t Count_Time_Hybrid(uint64_t usec, float ticks_per_us)
+    ATTRIBUTE_DISABLE_OPTIMIZATIONS;
+
 // Actively wait for the specified amount of microseconds, by repeatedly
 // checking whether the time has elapsed.
 // Returns the number of calls to clock_gettime.
@@ -0,0 +1,216 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#define TIMESOURCE_X86 1
+#elif defined(__aarch64__)
+#define TIMESOURCE_ARM64 1
+#endif
+
+#include "time_aux.h"
+#include "timesource.h"
+
+// In timesource_spin_ns(), two consecutive reads farther apart than this mean
+// that the thread was preempted (or interrupted) in between
+#define TIMESOURCE_GAP_NS 5000
+
+// How often each thread re-anchors the counter to CLOCK_MONOTONIC
+#define TIMESOURCE_RESYNC_NS 100000000
+
+// ----------------------- Local function declarations ---------------------- //
+
+static void timesource_select(void);
+
+// --------------------------- Time source state ---------------------------- //
+
+static pthread_once_t timesource_once = PTHREAD_ONCE_INIT;
+
+static int use_counter = 0;
+static double counter_hz = 0;
+static double ns_per_cycle = 0;
+
+// The reference point taken at calibration, in both time bases
+static uint64_t base_cycles = 0;
+static uint64_t base_ns = 0;
+
+// The short calibration leaves an error of a few ppm on the rate, so each
+// thread periodically re-anchors to CLOCK_MONOTONIC, refining the rate over
+// the (growing) interval since the calibration. This keeps timestamps within
+// a fraction of a microsecond of CLOCK_MONOTONIC, which they are compared to.
+static __thread uint64_t thread_base_cycles = 0;
+static __thread uint64_t thread_base_ns = 0;
+static __thread double thread_ns_per_cycle = 0;
+
+static inline void timesource_ensure(void) {
+    pthread_once(&timesource_once, timesource_select);
+}
+
+static inline uint64_t read_counter(void) {
+#if defined(TIMESOURCE_X86)
+    // Do not let the read move before the preceding instructions
+    _mm_lfence();
+    return __rdtsc();
+#elif defined(TIMESOURCE_ARM64)
+    uint64_t value;
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(value)::"memory");
+    return value;
+#else
+    return 0;
+#endif
+}
+
+static inline uint64_t clock_ns(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return SEC_TO_NSEC((uint64_t)ts.tv_sec) + (uint64_t)ts.tv_nsec;
+}
+
+// ----------------------- Public function definitions ---------------------- //
+
+void timesource_init(void) {
+    timesource_ensure();
+}
+
+int timesource_is_counter(void) {
+    timesource_ensure();
+    return use_counter;
+}
+
+double timesource_counter_hz(void) {
+    timesource_ensure();
+    return counter_hz;
+}
+
+uint64_t timesource_now_ns(void) {
+    timesource_ensure();
+    if (!use_counter) {
+        return clock_ns(CLOCK_MONOTONIC);
+    }
+
+    const uint64_t now = read_counter();
+    if (thread_ns_per_cycle == 0 ||
+        (double)(now - thread_base_cycles) * thread_ns_per_cycle >
+            TIMESOURCE_RESYNC_NS) {
+        thread_base_ns = clock_ns(CLOCK_MONOTONIC);
+        thread_base_cycles = read_counter();
+        thread_ns_per_cycle =
+            thread_base_ns - base_ns > SEC_TO_NSEC(1ULL)
+                ? (double)(thread_base_ns - base_ns) /
+                      (double)(thread_base_cycles - base_cycles)
+                : ns_per_cycle;
+        return thread_base_ns;
+    }
+
+    // Signed, other CPUs may be slightly behind the reference point
+    const int64_t delta = (int64_t)(now - thread_base_cycles);
+    return thread_base_ns + (int64_t)((double)delta * thread_ns_per_cycle);
+}
+
+uint64_t timesource_spin_ns(uint64_t ns) {
+    uint64_t iterations = 0;
+
+    timesource_ensure();
+    if (!use_counter) {
+        // NOTICE that we care only of the time spent while running THIS task,
+        // not the wall time.
+        const uint64_t begin = clock_ns(CLOCK_THREAD_CPUTIME_ID);
+        do {
+            iterations++;
+        } while (clock_ns(CLOCK_THREAD_CPUTIME_ID) - begin < ns);
+        return iterations;
+    }
+
+    // The counter runs in wall time, so the gaps due to preemption are
+    // skipped to count only the time spent running THIS task
+    const uint64_t target = (double)ns / ns_per_cycle;
+    const uint64_t gap = TIMESOURCE_GAP_NS / ns_per_cycle;
+
+    uint64_t elapsed = 0;
+    uint64_t prev = read_counter();
+    while (elapsed < target) {
+        const uint64_t now = read_counter();
+        if (now - prev < gap) {
+            elapsed += now - prev;
+        }
+        prev = now;
+        iterations++;
+    }
+
+    return iterations;
+}
+
+// ------------------------ Local function definitions ---------------------- //
+
+static int counter_usable(void) {
+    const char *env = getenv("RTDAG_TIMESOURCE");
+    if (env != NULL && strcmp(env, "clock") == 0) {
+        return 0;
+    }
+
+#if RTDAG_TSC != ON
+    return 0;
+#elif defined(TIMESOURCE_X86)
+    // Invariant TSC: constant rate in all P-, C- and T-states
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx) ||
+        !(edx & (1u << 8))) {
+        return 0;
+    }
+
+    // The kernel switches away from the TSC when it finds it unreliable
+    // (e.g., not synchronized among CPUs)
+    FILE *f = fopen(
+        "/sys/devices/system/clocksource/clocksource0/current_clocksource",
+        "r");
+    if (f != NULL) {
+        char name[32] = {0};
+        int is_tsc = fscanf(f, "%31s", name) == 1 && strcmp(name, "tsc") == 0;
+        fclose(f);
+        return is_tsc;
+    }
+    return 1;
+#elif defined(TIMESOURCE_ARM64)
+    // The generic timer always runs at a constant rate
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static void timesource_select(void) {
+    if (!counter_usable()) {
+        return;
+    }
+
+#if defined(TIMESOURCE_ARM64)
+    uint64_t freq;
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+    counter_hz = freq;
+    base_ns = clock_ns(CLOCK_MONOTONIC);
+    base_cycles = read_counter();
+#else
+    // Measure the counter rate against CLOCK_MONOTONIC over ~20ms
+    const uint64_t ns0 = clock_ns(CLOCK_MONOTONIC);
+    const uint64_t cycles0 = read_counter();
+
+    struct timespec delay = {0, 20 * 1000 * 1000};
+    nanosleep(&delay, NULL);
+
+    base_ns = clock_ns(CLOCK_MONOTONIC);
+    base_cycles = read_counter();
+    counter_hz = (double)(base_cycles - cycles0) * 1e9 / (base_ns - ns0);
+#endif
+
+    if (counter_hz > 0) {
+        ns_per_cycle = 1e9 / counter_hz;
+        use_counter = 1;
+    }
+}
@@ -0,0 +1,41 @@
+#ifndef TIMESOURCE_H_
+#define TIMESOURCE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Time source used for timestamps and busy-waiting.
+//
+// When RTDAG_TSC is enabled and the CPU provides a constant-rate counter that
+// the kernel trusts (the invariant TSC on x86, used as clocksource, or the
+// generic timer on aarch64), timestamps are read directly from it, without
+// entering clock_gettime(). On x86 the counter is calibrated against
+// CLOCK_MONOTONIC by timesource_init(). Otherwise, clock_gettime() is used.
+// Setting the environment variable RTDAG_TIMESOURCE=clock forces the fallback.
+
+// Selects (and calibrates) the time source, takes about 20ms when the TSC is
+// used. Called automatically on first use, but it should be called at
+// startup to keep the calibration out of the measurements.
+extern void timesource_init(void);
+
+// Returns 1 if the counter is used, 0 if clock_gettime() is used
+extern int timesource_is_counter(void);
+
+// The frequency of the counter in Hz (0 if not used)
+extern double timesource_counter_hz(void);
+
+// Nanoseconds on the CLOCK_MONOTONIC time base
+extern uint64_t timesource_now_ns(void);
+
+// Busy-waits until the calling thread has run for the given amount of ns,
+// not counting the time it was preempted. Returns the number of iterations.
+extern uint64_t timesource_spin_ns(uint64_t ns);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TIMESOURCE_H_